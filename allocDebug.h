@@ -0,0 +1,90 @@
+#ifndef ALLOC_DEBUG_H
+#define ALLOC_DEBUG_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+// hardening helpers for the arena/pool/slab allocators.
+// build with -DALLOC_DEBUG to get guard canaries around every block,
+// poison-on-free, free list checks and double free detection.
+// without it none of this is compiled into the allocators
+
+#if defined(__SANITIZE_ADDRESS__)
+#define ALLOC_HAVE_ASAN 1
+#elif defined(__has_feature)
+#if __has_feature(address_sanitizer)
+#define ALLOC_HAVE_ASAN 1
+#endif
+#endif
+
+#ifdef ALLOC_HAVE_ASAN
+#include <sanitizer/asan_interface.h>
+#define ALLOC_ASAN_POISON(p, n)   ASAN_POISON_MEMORY_REGION((p), (n))
+#define ALLOC_ASAN_UNPOISON(p, n) ASAN_UNPOISON_MEMORY_REGION((p), (n))
+#else
+#define ALLOC_ASAN_POISON(p, n)   ((void)(p), (void)(n))
+#define ALLOC_ASAN_UNPOISON(p, n) ((void)(p), (void)(n))
+#endif
+
+#ifdef ALLOC_DEBUG
+#define ALLOC_DEBUG_BUILD 1
+#define ALLOC_DEBUG_MODE_STR "debug (canaries + poisoning)"
+#else
+#define ALLOC_DEBUG_BUILD 0
+#define ALLOC_DEBUG_MODE_STR "release"
+#endif
+
+#define ALLOC_GUARD_SIZE 16     // canary bytes on each side, keeps payload 16-aligned
+#define ALLOC_CANARY 0xCA11AB1EDEADC0DEULL
+#define ALLOC_POISON_FREED 0xDD // what freed memory looks like
+#define ALLOC_POISON_FRESH 0xCD // what newly handed out memory looks like
+
+static inline void alloc_debug_fail(const char* who, const char* what, const void* ptr) {
+    fprintf(stderr, "%s: %s (ptr=%p)\n", who, what, ptr);
+    abort();
+}
+
+static inline void alloc_write_canary(void* guard) {
+    uint64_t* words = (uint64_t*)guard;
+    for (size_t i = 0; i < ALLOC_GUARD_SIZE / sizeof(uint64_t); i++) {
+        words[i] = ALLOC_CANARY;
+    }
+}
+
+static inline int alloc_check_canary(const void* guard) {
+    const uint64_t* words = (const uint64_t*)guard;
+    for (size_t i = 0; i < ALLOC_GUARD_SIZE / sizeof(uint64_t); i++) {
+        if (words[i] != ALLOC_CANARY) return 0;
+    }
+    return 1;
+}
+
+// returns 1 if every byte still holds the freed pattern (nobody wrote after free)
+static inline int alloc_check_poison(const void* p, size_t n) {
+    const unsigned char* bytes = (const unsigned char*)p;
+    for (size_t i = 0; i < n; i++) {
+        if (bytes[i] != ALLOC_POISON_FREED) return 0;
+    }
+    return 1;
+}
+
+// one bit per block, set while the block is handed out
+static inline uint8_t* alloc_bitmap_create(size_t nbits) {
+    return calloc((nbits + 7) / 8, 1);
+}
+
+static inline int alloc_bitmap_test(const uint8_t* bits, size_t i) {
+    return (bits[i >> 3] >> (i & 7)) & 1;
+}
+
+static inline void alloc_bitmap_set(uint8_t* bits, size_t i) {
+    bits[i >> 3] |= (uint8_t)(1u << (i & 7));
+}
+
+static inline void alloc_bitmap_clear(uint8_t* bits, size_t i) {
+    bits[i >> 3] &= (uint8_t)~(1u << (i & 7));
+}
+
+#endif /* ALLOC_DEBUG_H */
@@ -0,0 +1,83 @@
+#ifndef ALLOC_STATS_H
+#define ALLOC_STATS_H
+
+#include <stdio.h>
+#include <stddef.h>
+
+// usage counters shared by the arena, pool and slab allocators.
+// they live in each allocator instance rather than in thread locals:
+// every instance is owned by one thread, so per instance already means
+// per thread and the fields can stay plain, no atomics.
+// build with -DALLOC_NO_STATS to compile them out
+struct alloc_stats {
+    size_t bytes_in_use;        // bytes currently handed out (block/obj granularity)
+    size_t peak_bytes_in_use;   // high water mark of bytes_in_use
+    size_t alloc_count;
+    size_t free_count;
+    size_t failed_allocs;
+    size_t slabs_created;       // slabs for slab caches, backing regions for pool/arena
+    size_t slabs_destroyed;
+    size_t bytes_requested;     // lifetime total the callers asked for
+    size_t bytes_granted;       // lifetime total actually handed out
+};
+
+#ifndef ALLOC_NO_STATS
+
+#define STATS_ALLOC(s, requested, granted) do {                 \
+        (s)->alloc_count++;                                     \
+        (s)->bytes_requested += (requested);                    \
+        (s)->bytes_granted += (granted);                        \
+        (s)->bytes_in_use += (granted);                         \
+        if ((s)->bytes_in_use > (s)->peak_bytes_in_use)         \
+            (s)->peak_bytes_in_use = (s)->bytes_in_use;         \
+    } while (0)
+
+#define STATS_FREE(s, granted) do {                             \
+        (s)->free_count++;                                      \
+        (s)->bytes_in_use -= (granted);                         \
+    } while (0)
+
+#define STATS_FAIL(s)            ((s)->failed_allocs++)
+#define STATS_SLAB_CREATED(s)    ((s)->slabs_created++)
+#define STATS_SLAB_DESTROYED(s)  ((s)->slabs_destroyed++)
+#define STATS_RESET_IN_USE(s)    ((s)->bytes_in_use = 0)
+// a reset that releases n live allocations at once
+#define STATS_FREE_ALL(s, n) do {                               \
+        (s)->free_count += (n);                                 \
+        (s)->bytes_in_use = 0;                                  \
+    } while (0)
+
+#else
+
+// sizeof keeps locals that only feed the counters "used" without evaluating them
+#define STATS_ALLOC(s, requested, granted)  ((void)sizeof(requested), (void)sizeof(granted))
+#define STATS_FREE(s, granted)              ((void)sizeof(granted))
+#define STATS_FAIL(s)                       ((void)0)
+#define STATS_SLAB_CREATED(s)               ((void)0)
+#define STATS_SLAB_DESTROYED(s)             ((void)0)
+#define STATS_RESET_IN_USE(s)               ((void)0)
+#define STATS_FREE_ALL(s, n)                ((void)sizeof(n))
+
+#endif
+
+// internal fragmentation as the fraction of granted bytes nobody asked for
+static inline double alloc_stats_fragmentation(const struct alloc_stats* s) {
+    if (s->bytes_granted == 0) return 0.0;
+    return 1.0 - (double)s->bytes_requested / (double)s->bytes_granted;
+}
+
+static inline void alloc_stats_print(const char* label, const struct alloc_stats* s) {
+#ifndef ALLOC_NO_STATS
+    printf("%s stats:\n", label);
+    printf("  in use: %zu bytes, peak: %zu bytes\n", s->bytes_in_use, s->peak_bytes_in_use);
+    printf("  allocs: %zu, frees: %zu, failed: %zu\n",
+           s->alloc_count, s->free_count, s->failed_allocs);
+    printf("  slabs created: %zu, destroyed: %zu\n", s->slabs_created, s->slabs_destroyed);
+    printf("  internal fragmentation: %.2f%%\n", 100.0 * alloc_stats_fragmentation(s));
+#else
+    (void)s;
+    printf("%s stats: compiled out (ALLOC_NO_STATS)\n", label);
+#endif
+}
+
+#endif /* ALLOC_STATS_H */
@@ -5,16 +5,46 @@
 #include <math.h> 
 #include <unistd.h>    
 #include "allocator.h"
+#include "perfCounters.h"
+#include "allocDebug.h"
+#include "kernels.h"
+#include "weightFile.h"
+#include "threadArena.h"
+#include "trace.h"
 
-float W1_data[INPUT_DIM * HIDDEN_DIM];
-float b1_data[HIDDEN_DIM];
-float W2_data[HIDDEN_DIM * OUTPUT_DIM];
-float b2_data[OUTPUT_DIM];
+const float* W1_data;
+const float* Wh_data;   // hidden -> hidden, shared by the three middle layers
+const float* b1_data;
+const float* W2_data;
+const float* b2_data;
 Tensor W1;
+Tensor Wh;
 Tensor W2;
 
+struct weight_file* weights = NULL;
+
+// maps the weights, making a random model there first if the file is
+// missing or was saved for different layer sizes
+void load_weights(const char* path) {
+    const struct weight_spec specs[] = {
+        {"W1", INPUT_DIM, HIDDEN_DIM, &W1_data},
+        {"Wh", HIDDEN_DIM, HIDDEN_DIM, &Wh_data},
+        {"b1", 1, HIDDEN_DIM, &b1_data},
+        {"W2", HIDDEN_DIM, OUTPUT_DIM, &W2_data},
+        {"b2", 1, OUTPUT_DIM, &b2_data},
+    };
+    weights = weight_file_load_or_create(path, specs, sizeof(specs) / sizeof(specs[0]));
+    if (!weights) {
+        printf("Failed to load weights from %s!\n", path);
+        exit(1);
+    }
+}
+
 void* default_malloc(size_t size) {
-    return malloc(size);
+    TRACE_BEGIN("malloc");
+    void* ptr = malloc(size);
+    TRACE_END("malloc");
+    return ptr;
 }
 
 void* custom_malloc(size_t size) {
@@ -23,7 +53,9 @@ void* custom_malloc(size_t size) {
 
 void free_tensor(Tensor* t) {
     if (t && t->data) {
+        TRACE_BEGIN("free");
         free(t->data);
+        TRACE_END("free");
         t->data = NULL;
     }
 }
@@ -39,6 +71,48 @@ void clear_cpu_cache() {
 }
 
 Arena tensor_arena={0};
+
+#ifdef ALLOC_DEBUG
+// debug layout of each arena allocation: [header][payload][guard]
+// state doubles as the front canary, it flips to ARENA_FREED on free_arena_tensor
+#define ARENA_FREED 0xF4EEF4EEF4EEF4EEULL
+struct arena_debug_header {
+    size_t size;
+    uint64_t state;
+};
+
+static struct arena_debug_header* arena_debug_header_of(void* ptr){
+    char* base = tensor_arena.memory;
+    char* hdr = (char*)ptr - sizeof(struct arena_debug_header);
+    if(hdr < base || hdr >= base + tensor_arena.used){
+        alloc_debug_fail("free_arena_tensor", "pointer not from the arena", ptr);
+    }
+    return (struct arena_debug_header*)hdr;
+}
+
+static void arena_debug_check(struct arena_debug_header* hdr, const char* who){
+    char* payload = (char*)(hdr + 1);
+    if(hdr->state != ALLOC_CANARY && hdr->state != ARENA_FREED){
+        alloc_debug_fail(who, "buffer underflow or bad header", payload);
+    }
+    if(!alloc_check_canary(payload + hdr->size)) alloc_debug_fail(who, "buffer overflow", payload);
+}
+
+// walks every allocation since the last reset, then poisons the lot
+static void arena_debug_reset(){
+    char* base = tensor_arena.memory;
+    size_t off = 0;
+    while(off < tensor_arena.used){
+        struct arena_debug_header* hdr = (struct arena_debug_header*)(base + off);
+        arena_debug_check(hdr, "reset_arena");
+        off += sizeof(*hdr) + hdr->size + ALLOC_GUARD_SIZE;
+    }
+    ALLOC_ASAN_UNPOISON(base, tensor_arena.used);
+    memset(base, ALLOC_POISON_FREED, tensor_arena.used);
+    ALLOC_ASAN_POISON(base, tensor_arena.total_size);
+}
+#endif
+
 void init_arena(){
 if(tensor_arena.initialized ==0){
     tensor_arena.memory= malloc(ARENA_SIZE);
@@ -49,27 +123,54 @@ if(tensor_arena.initialized ==0){
     tensor_arena.total_size=ARENA_SIZE;
     tensor_arena.initialized=1;
     tensor_arena.used=0;
+    STATS_SLAB_CREATED(&tensor_arena.stats);
+    ALLOC_ASAN_POISON(tensor_arena.memory, tensor_arena.total_size);
 }
 }
 
 void reset_arena(){
+#ifdef ALLOC_DEBUG
+    if(tensor_arena.initialized) arena_debug_reset();
+#else
+    if(tensor_arena.initialized) ALLOC_ASAN_POISON(tensor_arena.memory, tensor_arena.total_size);
+#endif
     tensor_arena.used =0;
+    STATS_RESET_IN_USE(&tensor_arena.stats);
 }
 
-void* arena_malloc(size_t size){
+static void* arena_alloc_block(size_t size){
     if(!tensor_arena.initialized){
         init_arena();
     }
     //can experiment with 8 or 16 alignment ...currently it's 8 
-    size = (size + 7) & -7;
+    size_t requested = size;
+    size = (size + 7) & ~(size_t)7;
+#ifdef ALLOC_DEBUG
+    size = (size + 15) & ~(size_t)15;
+    size_t payload_size = size;
+    size += sizeof(struct arena_debug_header) + ALLOC_GUARD_SIZE;
+#endif
 
     if (tensor_arena.used + size > tensor_arena.total_size) {
         fprintf(stderr, "Arena out of memory\n");
+        STATS_FAIL(&tensor_arena.stats);
         return NULL;
     }
     
     void* ptr = (char*)tensor_arena.memory + tensor_arena.used;
     tensor_arena.used += size;
+    STATS_ALLOC(&tensor_arena.stats, requested, size);
+    // init_arena poisons the whole arena under ASan, debug build or not
+    ALLOC_ASAN_UNPOISON(ptr, size);
+
+#ifdef ALLOC_DEBUG
+    struct arena_debug_header* hdr = ptr;
+    hdr->size = payload_size;
+    hdr->state = ALLOC_CANARY;
+    ptr = hdr + 1;
+    memset(ptr, ALLOC_POISON_FRESH, payload_size);
+    alloc_write_canary((char*)ptr + payload_size);
+#endif
     
     return ptr;
 
@@ -77,59 +178,94 @@ void* arena_malloc(size_t size){
 
 void delete_arena(){
     if(tensor_arena.initialized){
+        ALLOC_ASAN_UNPOISON(tensor_arena.memory, tensor_arena.total_size);
         free(tensor_arena.memory);
         tensor_arena.memory = NULL;//uaf mitigation
         tensor_arena.initialized=0;
         tensor_arena.used =0;
+        STATS_RESET_IN_USE(&tensor_arena.stats);
+        STATS_SLAB_DESTROYED(&tensor_arena.stats);
     }
 }
+void* arena_malloc(size_t size){
+    TRACE_BEGIN("arena_malloc");
+    void* ptr = arena_alloc_block(size);
+    TRACE_END("arena_malloc");
+    return ptr;
+}
+
 void free_arena_tensor(Tensor* t){
-    if(t) t->data = NULL;
+    // nothing comes back until reset_arena, so only the count moves
+    if(t){
+        TRACE_BEGIN("arena_free");
+#ifdef ALLOC_DEBUG
+        if(t->data){
+            struct arena_debug_header* hdr = arena_debug_header_of(t->data);
+            if(hdr->state == ARENA_FREED) alloc_debug_fail("free_arena_tensor", "double free", t->data);
+            arena_debug_check(hdr, "free_arena_tensor");
+            hdr->state = ARENA_FREED;
+            memset(t->data, ALLOC_POISON_FREED, hdr->size);
+            ALLOC_ASAN_POISON(t->data, hdr->size);
+        }
+#endif
+        t->data = NULL;
+        STATS_FREE(&tensor_arena.stats, 0);
+        TRACE_END("arena_free");
+    }
+}
+
+void arena_get_stats(struct alloc_stats* out){
+    if(out) *out = tensor_arena.stats;
 }
 
 
 
+// one kernel per layer shape the forward pass actually runs
+MATMUL_KERNEL(BATCH_SIZE, INPUT_DIM, HIDDEN_DIM)
+MATMUL_KERNEL(BATCH_SIZE, HIDDEN_DIM, HIDDEN_DIM)
+MATMUL_KERNEL(BATCH_SIZE, HIDDEN_DIM, OUTPUT_DIM)
+
+const struct matmul_kernel matmul_kernels[] = {
+    MATMUL_KERNEL_ENTRY(BATCH_SIZE, INPUT_DIM, HIDDEN_DIM),
+    MATMUL_KERNEL_ENTRY(BATCH_SIZE, HIDDEN_DIM, HIDDEN_DIM),
+    MATMUL_KERNEL_ENTRY(BATCH_SIZE, HIDDEN_DIM, OUTPUT_DIM),
+};
+#define NUM_MATMUL_KERNELS (int)(sizeof(matmul_kernels) / sizeof(matmul_kernels[0]))
+
 void matmul(const Tensor* A, const Tensor* B, Tensor* out) {
-    float* a = (float*)A->data;
-    float* b = (float*)B->data;
-    float* c = (float*)out->data;
-    //off of wikipedia just the easiest way 
-    for (int i = 0; i < A->rows; i++) {
-        for (int j = 0; j < B->cols; j++) {
-            c[i * out->cols + j] = 0;
-            for (int k = 0; k < A->cols; k++) {
-                c[i * out->cols + j] += a[i * A->cols + k] * b[k * B->cols + j];
-            }
-        }
-    }
+    kernels_matmul(matmul_kernels, NUM_MATMUL_KERNELS, A, B, out);
 }
 
 void add_bias(Tensor* out, const float* bias) {
     float* data = (float*)out->data;
+    TRACE_BEGIN("add_bias");
     for (int i = 0; i < out->rows; i++) {
         for (int j = 0; j < out->cols; j++) {
             data[i * out->cols + j] += bias[j];
         }
     }
+    TRACE_END("add_bias");
 }
 
 void relu(Tensor* t) {
     float* data = (float*)t->data;
     int size = t->rows * t->cols;
+    TRACE_BEGIN("relu");
     for (int i = 0; i < size; i++) {
         if (data[i] < 0) {
             data[i] = 0;
         }
     }
+    TRACE_END("relu");
 }
 
 void run_standard_allocator() {
-    Tensor input = {malloc(sizeof(float)*BATCH_SIZE*INPUT_DIM), BATCH_SIZE, INPUT_DIM};
-    Tensor h1 = {malloc(sizeof(float)*BATCH_SIZE*HIDDEN_DIM), BATCH_SIZE, HIDDEN_DIM};
-    Tensor h2 = {malloc(sizeof(float)*BATCH_SIZE*HIDDEN_DIM), BATCH_SIZE, HIDDEN_DIM};
-    Tensor h3 = {malloc(sizeof(float)*BATCH_SIZE*HIDDEN_DIM), BATCH_SIZE, HIDDEN_DIM};
-    Tensor h4 = {malloc(sizeof(float)*BATCH_SIZE*HIDDEN_DIM), BATCH_SIZE, HIDDEN_DIM};
-    Tensor output = {malloc(sizeof(float)*BATCH_SIZE*OUTPUT_DIM), BATCH_SIZE, OUTPUT_DIM};
+    Tensor input = {default_malloc(sizeof(float)*BATCH_SIZE*INPUT_DIM), BATCH_SIZE, INPUT_DIM, LAYOUT_ROW_MAJOR};
+    Tensor h1 = {default_malloc(sizeof(float)*BATCH_SIZE*HIDDEN_DIM), BATCH_SIZE, HIDDEN_DIM, LAYOUT_ROW_MAJOR};
+    Tensor h2 = {default_malloc(sizeof(float)*BATCH_SIZE*HIDDEN_DIM), BATCH_SIZE, HIDDEN_DIM, LAYOUT_ROW_MAJOR};
+    Tensor h3 = {default_malloc(sizeof(float)*BATCH_SIZE*HIDDEN_DIM), BATCH_SIZE, HIDDEN_DIM, LAYOUT_ROW_MAJOR};
+    Tensor h4 = {default_malloc(sizeof(float)*BATCH_SIZE*HIDDEN_DIM), BATCH_SIZE, HIDDEN_DIM, LAYOUT_ROW_MAJOR};
+    Tensor output = {default_malloc(sizeof(float)*BATCH_SIZE*OUTPUT_DIM), BATCH_SIZE, OUTPUT_DIM, LAYOUT_ROW_MAJOR};
     
     for (int i = 0; i < BATCH_SIZE*INPUT_DIM; i++) {
         ((float*)input.data)[i] = -5.0f + ((float)rand() / (float)RAND_MAX) * 10.0f;
@@ -139,15 +275,15 @@ void run_standard_allocator() {
     add_bias(&h1, b1_data);
     relu(&h1);
     
-    matmul(&h1, &W1, &h2);
+    matmul(&h1, &Wh, &h2);
     add_bias(&h2, b1_data);
     relu(&h2);
     
-    matmul(&h2, &W1, &h3);
+    matmul(&h2, &Wh, &h3);
     add_bias(&h3, b1_data);
     relu(&h3);
     
-    matmul(&h3, &W1, &h4);
+    matmul(&h3, &Wh, &h4);
     add_bias(&h4, b1_data);
     relu(&h4);
     
@@ -165,12 +301,12 @@ void run_standard_allocator() {
 void run_custom_allocator() {
     reset_arena();
     
-    Tensor input = {arena_malloc(sizeof(float)*BATCH_SIZE*INPUT_DIM), BATCH_SIZE, INPUT_DIM};
-    Tensor h1 = {arena_malloc(sizeof(float)*BATCH_SIZE*HIDDEN_DIM), BATCH_SIZE, HIDDEN_DIM};
-    Tensor h2 = {arena_malloc(sizeof(float)*BATCH_SIZE*HIDDEN_DIM), BATCH_SIZE, HIDDEN_DIM};
-    Tensor h3 = {arena_malloc(sizeof(float)*BATCH_SIZE*HIDDEN_DIM), BATCH_SIZE, HIDDEN_DIM};
-    Tensor h4 = {arena_malloc(sizeof(float)*BATCH_SIZE*HIDDEN_DIM), BATCH_SIZE, HIDDEN_DIM};
-    Tensor output = {arena_malloc(sizeof(float)*BATCH_SIZE*OUTPUT_DIM), BATCH_SIZE, OUTPUT_DIM};
+    Tensor input = {arena_malloc(sizeof(float)*BATCH_SIZE*INPUT_DIM), BATCH_SIZE, INPUT_DIM, LAYOUT_ROW_MAJOR};
+    Tensor h1 = {arena_malloc(sizeof(float)*BATCH_SIZE*HIDDEN_DIM), BATCH_SIZE, HIDDEN_DIM, LAYOUT_ROW_MAJOR};
+    Tensor h2 = {arena_malloc(sizeof(float)*BATCH_SIZE*HIDDEN_DIM), BATCH_SIZE, HIDDEN_DIM, LAYOUT_ROW_MAJOR};
+    Tensor h3 = {arena_malloc(sizeof(float)*BATCH_SIZE*HIDDEN_DIM), BATCH_SIZE, HIDDEN_DIM, LAYOUT_ROW_MAJOR};
+    Tensor h4 = {arena_malloc(sizeof(float)*BATCH_SIZE*HIDDEN_DIM), BATCH_SIZE, HIDDEN_DIM, LAYOUT_ROW_MAJOR};
+    Tensor output = {arena_malloc(sizeof(float)*BATCH_SIZE*OUTPUT_DIM), BATCH_SIZE, OUTPUT_DIM, LAYOUT_ROW_MAJOR};
     
     for (int i = 0; i < BATCH_SIZE*INPUT_DIM; i++) {
         ((float*)input.data)[i] = -5.0f + ((float)rand() / (float)RAND_MAX) * 10.0f;
@@ -180,15 +316,15 @@ void run_custom_allocator() {
     add_bias(&h1, b1_data);
     relu(&h1);
     
-    matmul(&h1, &W1, &h2);
+    matmul(&h1, &Wh, &h2);
     add_bias(&h2, b1_data);
     relu(&h2);
     
-    matmul(&h2, &W1, &h3);
+    matmul(&h2, &Wh, &h3);
     add_bias(&h3, b1_data);
     relu(&h3);
     
-    matmul(&h3, &W1, &h4);
+    matmul(&h3, &Wh, &h4);
     add_bias(&h4, b1_data);
     relu(&h4);
     
@@ -204,35 +340,79 @@ void run_custom_allocator() {
     free_arena_tensor(&output);
 }
 
+// same forward pass, but scratch comes from this thread's arena and the
+// whole request is dropped in one go at request_end
+void run_thread_arena_allocator() {
+    request_begin();
+    
+    Tensor input = {request_alloc(sizeof(float)*BATCH_SIZE*INPUT_DIM), BATCH_SIZE, INPUT_DIM, LAYOUT_ROW_MAJOR};
+    Tensor h1 = {request_alloc(sizeof(float)*BATCH_SIZE*HIDDEN_DIM), BATCH_SIZE, HIDDEN_DIM, LAYOUT_ROW_MAJOR};
+    Tensor h2 = {request_alloc(sizeof(float)*BATCH_SIZE*HIDDEN_DIM), BATCH_SIZE, HIDDEN_DIM, LAYOUT_ROW_MAJOR};
+    Tensor h3 = {request_alloc(sizeof(float)*BATCH_SIZE*HIDDEN_DIM), BATCH_SIZE, HIDDEN_DIM, LAYOUT_ROW_MAJOR};
+    Tensor h4 = {request_alloc(sizeof(float)*BATCH_SIZE*HIDDEN_DIM), BATCH_SIZE, HIDDEN_DIM, LAYOUT_ROW_MAJOR};
+    Tensor output = {request_alloc(sizeof(float)*BATCH_SIZE*OUTPUT_DIM), BATCH_SIZE, OUTPUT_DIM, LAYOUT_ROW_MAJOR};
+    
+    for (int i = 0; i < BATCH_SIZE*INPUT_DIM; i++) {
+        ((float*)input.data)[i] = -5.0f + ((float)rand() / (float)RAND_MAX) * 10.0f;
+    }
+    
+    matmul(&input, &W1, &h1);
+    add_bias(&h1, b1_data);
+    relu(&h1);
+    
+    matmul(&h1, &Wh, &h2);
+    add_bias(&h2, b1_data);
+    relu(&h2);
+    
+    matmul(&h2, &Wh, &h3);
+    add_bias(&h3, b1_data);
+    relu(&h3);
+    
+    matmul(&h3, &Wh, &h4);
+    add_bias(&h4, b1_data);
+    relu(&h4);
+    
+    matmul(&h4, &W2, &output);
+    add_bias(&output, b2_data);
+    
+    request_end();
+}
+
 int main(int argc, char *argv[]) {
     srand(time(NULL));
     
-    for(int i = 0; i < INPUT_DIM * HIDDEN_DIM; i++) {
-        W1_data[i] = -5.0f + ((float)rand() / (float)RAND_MAX) * 10.0f;
-    }
-    for(int i = 0; i < HIDDEN_DIM; i++) {
-        b1_data[i] = -5.0f + ((float)rand() / (float)RAND_MAX) * 10.0f;
-    }
-    for(int i = 0; i < HIDDEN_DIM * OUTPUT_DIM; i++) {
-        W2_data[i] = -5.0f + ((float)rand() / (float)RAND_MAX) * 10.0f;
-    }
-    for(int i = 0; i < OUTPUT_DIM; i++) {
-        b2_data[i] = -5.0f + ((float)rand() / (float)RAND_MAX) * 10.0f;
-    }
+    const char* weights_path = argc > 1 ? argv[1] : "weights_4x5x3.bin";
+    struct timespec load_start, load_end;
+    clock_gettime(CLOCK_MONOTONIC, &load_start);
+    load_weights(weights_path);
+    clock_gettime(CLOCK_MONOTONIC, &load_end);
+    printf("Mapped %zu bytes of weights from %s in %f seconds\n", weights->size, weights_path,
+           (load_end.tv_sec - load_start.tv_sec) + (load_end.tv_nsec - load_start.tv_nsec) / 1e9);
     
-    W1.data = W1_data;
+    W1.data = (float*)W1_data;
     W1.rows = INPUT_DIM;
     W1.cols = HIDDEN_DIM;
     
-    W2.data = W2_data;
+    Wh.data = (float*)Wh_data;
+    Wh.rows = HIDDEN_DIM;
+    Wh.cols = HIDDEN_DIM;
+    
+    W2.data = (float*)W2_data;
     W2.rows = HIDDEN_DIM;
     W2.cols = OUTPUT_DIM;
+    // no pack_weights() here like the 784 benchmarks: 5 and 3 column weights
+    // would be mostly panel padding, and kernels_benchmark shows the packed
+    // kernel losing to even the generic loop at this size
     
-    printf("Running benchmarks...\n");
+    printf("Running benchmarks (%s build)...\n", ALLOC_DEBUG_MODE_STR);
     
     const int NUM_ITERATIONS = 100;
-    double std_total = 0.0, custom_total = 0.0;
+    double std_total = 0.0, custom_total = 0.0, thread_total = 0.0;
     clock_t start, end;
+
+    struct perf_counters pc;
+    struct perf_totals std_perf = {0}, custom_perf = {0}, thread_perf = {0};
+    perf_counters_open(&pc);
     
     for (int i = 0; i < NUM_ITERATIONS; i++) {
 
@@ -244,10 +424,13 @@ int main(int argc, char *argv[]) {
 
 
 
+        perf_counters_start(&pc);
         start = clock();
         run_standard_allocator();
         // run_custom_allocator();
         end = clock();
+        perf_counters_stop(&pc);
+        perf_totals_add(&std_perf, &pc);
         double std_time = ((double) (end - start)) / CLOCKS_PER_SEC;
         std_total += std_time;
         printf("Standard allocator took %f seconds\n", std_time);
@@ -259,13 +442,28 @@ int main(int argc, char *argv[]) {
 
 
 
+        perf_counters_start(&pc);
         start = clock();
         run_custom_allocator();
         // run_standard_allocator();
         end = clock();
+        perf_counters_stop(&pc);
+        perf_totals_add(&custom_perf, &pc);
         double custom_time = ((double) (end - start)) / CLOCKS_PER_SEC;
         custom_total += custom_time;
         printf("Custom allocator took %f seconds\n", custom_time);
+
+        clear_cpu_cache();
+
+        perf_counters_start(&pc);
+        start = clock();
+        run_thread_arena_allocator();
+        end = clock();
+        perf_counters_stop(&pc);
+        perf_totals_add(&thread_perf, &pc);
+        double thread_time = ((double) (end - start)) / CLOCKS_PER_SEC;
+        thread_total += thread_time;
+        printf("Thread arena allocator took %f seconds\n", thread_time);
         
         usleep(1000);
     }
@@ -273,9 +471,38 @@ int main(int argc, char *argv[]) {
     printf("\n--- BENCHMARK RESULTS (%d iterations) ---\n", NUM_ITERATIONS);
     printf("Standard allocator average: %f seconds\n", std_total / NUM_ITERATIONS);
     printf("Custom allocator average: %f seconds\n", custom_total / NUM_ITERATIONS);
+    printf("Thread arena allocator average: %f seconds\n", thread_total / NUM_ITERATIONS);
     
     double improvement = 100.0 * (std_total - custom_total) / std_total;
     printf("Improvement: %f%%\n", improvement);
+    printf("Thread arena improvement: %f%%\n", 100.0 * (std_total - thread_total) / std_total);
+
+    perf_totals_print("Standard allocator", &std_perf);
+    perf_totals_print("Custom allocator", &custom_perf);
+    perf_totals_print("Thread arena allocator", &thread_perf);
+    perf_counters_close(&pc);
+
+    const char* sections[] = {"Standard allocator", "Custom allocator", "Thread arena allocator"};
+    double averages[] = {std_total / NUM_ITERATIONS, custom_total / NUM_ITERATIONS,
+                         thread_total / NUM_ITERATIONS};
+    perf_mode_compare("allocator", ALLOC_DEBUG_BUILD, sections, averages, 3);
+    kernels_benchmark(matmul_kernels, NUM_MATMUL_KERNELS);
+
+    struct alloc_stats arena_stats;
+    arena_get_stats(&arena_stats);
+    alloc_stats_print("Arena", &arena_stats);
+    alloc_stats_print("Thread arena", &thread_arena()->stats);
+    printf("Thread arena capacity after adapting: %zu bytes\n", thread_arena()->capacity);
+    thread_arena_release();
+
+#ifdef ALLOC_TRACE
+    trace_print_histograms();
+    if (trace_export_chrome("trace_arena.json") == 0) {
+        printf("Wrote trace_arena.json, open it in chrome://tracing or ui.perfetto.dev\n");
+    }
+#endif
+    
+    weight_file_close(weights);
     
     return 0;
 }
\ No newline at end of file
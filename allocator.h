@@ -1,6 +1,9 @@
 #ifndef ALLOCATOR_H
 #define ALLOCATOR_H
 
+#include "allocStats.h"
+#include "kernels.h"
+
 #define INPUT_DIM 4
 #define HIDDEN_DIM 5
 #define OUTPUT_DIM 3
@@ -8,13 +11,6 @@
 #define BATCH_SIZE 2
 
 #define ARENA_SIZE (1024*1024 * 10)//just a number lol 10MB 
-typedef struct {
-float* data;
-int rows;
-int cols;
-
-} Tensor;
-
 void matmul(const Tensor* A, const Tensor* B, Tensor* out);
 
 
@@ -31,8 +27,11 @@ size_t used;
 
 int initialized;
 
+struct alloc_stats stats;
 
 } Arena;
 
+void arena_get_stats(struct alloc_stats* out);
+
 
 #endif 
\ No newline at end of file
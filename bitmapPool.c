@@ -0,0 +1,192 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bitmapPool.h"
+#include "allocDebug.h"
+#include "trace.h"
+
+static void fill_bitmap(struct bitmap_pool* pool) {
+    memset(pool->bitmap, 0xFF, pool->num_words * sizeof(uint64_t));
+
+    // the last word may cover blocks that don't exist
+    size_t tail = pool->total_blocks & 63;
+    if (tail) pool->bitmap[pool->num_words - 1] = (1ULL << tail) - 1;
+
+    pool->first_free_word = 0;
+    pool->free_blocks = pool->total_blocks;
+}
+
+struct bitmap_pool* bitmap_pool_create(size_t block_size, size_t num_blocks) {
+    if (block_size == 0 || num_blocks == 0) return NULL;
+
+    struct bitmap_pool* pool = malloc(sizeof(struct bitmap_pool));
+    if (!pool) return NULL;
+
+    pool->memory = malloc(block_size * num_blocks);
+    pool->num_words = (num_blocks + 63) / 64;
+    pool->bitmap = malloc(pool->num_words * sizeof(uint64_t));
+    if (!pool->memory || !pool->bitmap) {
+        free(pool->memory);
+        free(pool->bitmap);
+        free(pool);
+        return NULL;
+    }
+
+    pool->block_size = block_size;
+    pool->total_blocks = num_blocks;
+    fill_bitmap(pool);
+
+    memset(&pool->stats, 0, sizeof(pool->stats));
+    STATS_SLAB_CREATED(&pool->stats);
+    return pool;
+}
+
+static inline void* take_lowest(struct bitmap_pool* pool, size_t w) {
+    uint64_t word = pool->bitmap[w];
+    unsigned bit = (unsigned)__builtin_ctzll(word);
+    pool->bitmap[w] = word & (word - 1);
+    return (char*)pool->memory + (w * 64 + bit) * pool->block_size;
+}
+
+static void* bitmap_alloc_block(struct bitmap_pool* pool, size_t size) {
+    if (!pool->free_blocks || size > pool->block_size) {
+        STATS_FAIL(&pool->stats);
+        return NULL;
+    }
+
+    size_t w = pool->first_free_word;
+    while (!pool->bitmap[w]) w++;   // free_blocks > 0 so this stops in range
+    pool->first_free_word = w;
+
+    void* block = take_lowest(pool, w);
+    pool->free_blocks--;
+    STATS_ALLOC(&pool->stats, size, pool->block_size);
+    return block;
+}
+
+void* bitmap_pool_alloc_sized(struct bitmap_pool* pool, size_t size) {
+    if (!pool) return NULL;
+    TRACE_BEGIN("bitmap_alloc");
+    void* block = bitmap_alloc_block(pool, size);
+    TRACE_END("bitmap_alloc");
+    return block;
+}
+
+void* bitmap_pool_alloc(struct bitmap_pool* pool) {
+    return pool ? bitmap_pool_alloc_sized(pool, pool->block_size) : NULL;
+}
+
+static size_t bitmap_alloc_bulk_blocks(struct bitmap_pool* pool, void** out,
+                                       const size_t* sizes, size_t n) {
+    int too_big = 0;
+    for (size_t i = 0; sizes && i < n; i++) {
+        if (sizes[i] > pool->block_size) too_big = 1;
+    }
+    if (n > pool->free_blocks || too_big) {
+        STATS_FAIL(&pool->stats);
+        return 0;
+    }
+
+    size_t got = 0;
+    size_t w = pool->first_free_word;
+    while (got < n) {
+        uint64_t word = pool->bitmap[w];
+        if (!word) {
+            w++;
+            continue;
+        }
+
+        char* base = (char*)pool->memory + w * 64 * pool->block_size;
+        if ((size_t)__builtin_popcountll(word) <= n - got) {
+            // the whole word fits, take every free bit in it
+            pool->bitmap[w] = 0;
+        } else {
+            // only the lowest (n - got) bits, the rest stay free
+            uint64_t keep = word;
+            for (size_t i = got; i < n; i++) keep &= keep - 1;
+            pool->bitmap[w] = keep;
+            word ^= keep;
+        }
+
+        while (word) {
+            unsigned bit = (unsigned)__builtin_ctzll(word);
+            out[got++] = base + bit * pool->block_size;
+            word &= word - 1;
+        }
+    }
+
+    pool->first_free_word = w;
+    pool->free_blocks -= n;
+#ifndef ALLOC_NO_STATS
+    for (size_t i = 0; i < n; i++) {
+        STATS_ALLOC(&pool->stats, sizes ? sizes[i] : pool->block_size, pool->block_size);
+    }
+#endif
+    return n;
+}
+
+size_t bitmap_pool_alloc_bulk_sized(struct bitmap_pool* pool, void** out,
+                                    const size_t* sizes, size_t n) {
+    if (!pool || !out) return 0;
+    TRACE_BEGIN("bitmap_alloc_bulk");
+    size_t got = bitmap_alloc_bulk_blocks(pool, out, sizes, n);
+    TRACE_END("bitmap_alloc_bulk");
+    return got;
+}
+
+size_t bitmap_pool_alloc_bulk(struct bitmap_pool* pool, void** out, size_t n) {
+    return bitmap_pool_alloc_bulk_sized(pool, out, NULL, n);
+}
+
+static void bitmap_free_block(struct bitmap_pool* pool, void* ptr) {
+    char* base = pool->memory;
+    if ((char*)ptr < base || (char*)ptr >= base + pool->total_blocks * pool->block_size) {
+#ifdef ALLOC_DEBUG
+        alloc_debug_fail("bitmap_pool_free", "pointer not from this pool", ptr);
+#endif
+        return;
+    }
+
+    size_t offset = (size_t)((char*)ptr - base);
+    size_t idx = offset / pool->block_size;
+    size_t w = idx >> 6;
+    uint64_t bit = 1ULL << (idx & 63);
+
+    // the bitmap makes these checks free, so they stay on in release too
+    if (offset % pool->block_size || (pool->bitmap[w] & bit)) {
+#ifdef ALLOC_DEBUG
+        alloc_debug_fail("bitmap_pool_free", "misaligned pointer or double free", ptr);
+#endif
+        return;
+    }
+
+    pool->bitmap[w] |= bit;
+    if (w < pool->first_free_word) pool->first_free_word = w;
+    pool->free_blocks++;
+    STATS_FREE(&pool->stats, pool->block_size);
+}
+
+void bitmap_pool_free(struct bitmap_pool* pool, void* ptr) {
+    if (!pool || !ptr) return;
+    TRACE_BEGIN("bitmap_free");
+    bitmap_free_block(pool, ptr);
+    TRACE_END("bitmap_free");
+}
+
+void bitmap_pool_reset(struct bitmap_pool* pool) {
+    if (!pool) return;
+    fill_bitmap(pool);
+    STATS_RESET_IN_USE(&pool->stats);
+}
+
+void bitmap_pool_destroy(struct bitmap_pool* pool) {
+    if (!pool) return;
+    free(pool->memory);
+    free(pool->bitmap);
+    free(pool);
+}
+
+void bitmap_pool_get_stats(const struct bitmap_pool* pool, struct alloc_stats* out) {
+    if (!pool || !out) return;
+    *out = pool->stats;
+}
@@ -0,0 +1,39 @@
+#ifndef BITMAP_POOL_H
+#define BITMAP_POOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "allocStats.h"
+
+// fixed size block pool indexed by a bitmap instead of an intrusive free list.
+// a set bit means the block is free, so tzcnt on a word gives the lowest
+// free block and the pool always hands out the lowest addresses first.
+// blocks are never written to by the allocator itself
+struct bitmap_pool {
+    void* memory;
+    size_t block_size;
+    size_t total_blocks;
+    size_t free_blocks;
+    uint64_t* bitmap;
+    size_t num_words;
+    size_t first_free_word;     // no free bits below this word
+    struct alloc_stats stats;
+};
+
+struct bitmap_pool* bitmap_pool_create(size_t block_size, size_t num_blocks);
+void* bitmap_pool_alloc(struct bitmap_pool* pool);
+// same as bitmap_pool_alloc but records how much of the block the caller
+// needs, so the stats can report internal fragmentation. fails if size > block_size
+void* bitmap_pool_alloc_sized(struct bitmap_pool* pool, size_t size);
+// grabs n blocks in one call, all or nothing. returns n on success, 0 otherwise
+size_t bitmap_pool_alloc_bulk(struct bitmap_pool* pool, void** out, size_t n);
+// bulk version of alloc_sized, sizes[i] is what out[i] is for
+size_t bitmap_pool_alloc_bulk_sized(struct bitmap_pool* pool, void** out,
+                                    const size_t* sizes, size_t n);
+void bitmap_pool_free(struct bitmap_pool* pool, void* ptr);
+// O(total_blocks / 64), nothing in the blocks themselves is touched
+void bitmap_pool_reset(struct bitmap_pool* pool);
+void bitmap_pool_destroy(struct bitmap_pool* pool);
+void bitmap_pool_get_stats(const struct bitmap_pool* pool, struct alloc_stats* out);
+
+#endif /* BITMAP_POOL_H */
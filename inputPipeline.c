@@ -0,0 +1,134 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <sched.h>
+#include "inputPipeline.h"
+#include "trace.h"
+
+#define PIPELINE_SPINS 64   // busy polls before we start yielding the core
+
+static inline void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    __asm__ volatile("yield");
+#endif
+}
+
+// the other side is usually only a few microseconds away, so spin briefly
+// before handing the core back to the scheduler
+static void backoff(int* spins) {
+    if (*spins < PIPELINE_SPINS) {
+        cpu_relax();
+        (*spins)++;
+    } else {
+        sched_yield();
+    }
+}
+
+static void* loader_main(void* arg) {
+    struct input_pipeline* pipe = arg;
+
+    while (!atomic_load_explicit(&pipe->stop, memory_order_relaxed)) {
+        float* batch = spsc_ring_pop(&pipe->free);
+        if (!batch) {
+            atomic_fetch_add_explicit(&pipe->loader_waits, 1, memory_order_relaxed);
+            int spins = 0;
+            while (!(batch = spsc_ring_pop(&pipe->free))) {
+                if (atomic_load_explicit(&pipe->stop, memory_order_relaxed)) return NULL;
+                backoff(&spins);
+            }
+        }
+
+        TRACE_BEGIN("load_batch");
+        pipe->fill(batch, pipe->rows, pipe->cols, pipe->ctx);
+        TRACE_END("load_batch");
+
+        // can't fail, there are only as many buffers as ring slots
+        spsc_ring_push(&pipe->ready, batch);
+        atomic_fetch_add_explicit(&pipe->batches_loaded, 1, memory_order_relaxed);
+    }
+    return NULL;
+}
+
+struct input_pipeline* input_pipeline_create(int rows, int cols, int depth,
+                                             input_fill_fn fill, void* ctx) {
+    if (rows <= 0 || cols <= 0 || depth <= 0 || !fill) return NULL;
+
+    // the rings inside are cache line aligned, plain malloc only promises 16.
+    // aligned_alloc wants the size to be a multiple of the alignment
+    size_t bytes = (sizeof(struct input_pipeline) + SPSC_CACHE_LINE - 1) & ~(size_t)(SPSC_CACHE_LINE - 1);
+    struct input_pipeline* pipe = aligned_alloc(SPSC_CACHE_LINE, bytes);
+    if (!pipe) return NULL;
+
+    pipe->rows = rows;
+    pipe->cols = cols;
+    pipe->fill = fill;
+    pipe->ctx = ctx;
+    pipe->compute_waits = 0;
+    atomic_init(&pipe->stop, 0);
+    atomic_init(&pipe->batches_loaded, 0);
+    atomic_init(&pipe->loader_waits, 0);
+
+    pipe->pool = pool_create(sizeof(float) * rows * cols, depth);
+    if (!pipe->pool) {
+        free(pipe);
+        return NULL;
+    }
+    if (!spsc_ring_init(&pipe->ready, depth)) {
+        pool_destroy(pipe->pool);
+        free(pipe);
+        return NULL;
+    }
+    if (!spsc_ring_init(&pipe->free, depth)) {
+        spsc_ring_destroy(&pipe->ready);
+        pool_destroy(pipe->pool);
+        free(pipe);
+        return NULL;
+    }
+
+    // every buffer starts out free, the loader fills them before it starts
+    // waiting on us
+    for (int i = 0; i < depth; i++) {
+        spsc_ring_push(&pipe->free, pool_alloc(pipe->pool));
+    }
+
+    if (pthread_create(&pipe->loader, NULL, loader_main, pipe) != 0) {
+        spsc_ring_destroy(&pipe->free);
+        spsc_ring_destroy(&pipe->ready);
+        pool_destroy(pipe->pool);
+        free(pipe);
+        return NULL;
+    }
+    return pipe;
+}
+
+float* input_pipeline_next(struct input_pipeline* pipe) {
+    float* batch = spsc_ring_pop(&pipe->ready);
+    if (batch) return batch;
+
+    pipe->compute_waits++;
+    TRACE_BEGIN("input_wait");
+    int spins = 0;
+    while (!(batch = spsc_ring_pop(&pipe->ready))) {
+        backoff(&spins);
+    }
+    TRACE_END("input_wait");
+    return batch;
+}
+
+void input_pipeline_release(struct input_pipeline* pipe, float* batch) {
+    spsc_ring_push(&pipe->free, batch);
+}
+
+void input_pipeline_destroy(struct input_pipeline* pipe) {
+    if (!pipe) return;
+
+    atomic_store_explicit(&pipe->stop, 1, memory_order_relaxed);
+    pthread_join(pipe->loader, NULL);
+
+    // buffers still in the rings or held by the caller all go with the pool
+    spsc_ring_destroy(&pipe->free);
+    spsc_ring_destroy(&pipe->ready);
+    pool_destroy(pipe->pool);
+    free(pipe);
+}
@@ -0,0 +1,45 @@
+#ifndef INPUT_PIPELINE_H
+#define INPUT_PIPELINE_H
+
+#include <stddef.h>
+#include <pthread.h>
+#include "poolAllocator.h"
+#include "spscRing.h"
+
+// fills one rows x cols batch, runs on the loader thread
+typedef void (*input_fill_fn)(float* data, int rows, int cols, void* ctx);
+
+// a loader thread keeps up to depth batches filled ahead of the compute
+// thread. buffers come out of a memory_pool once at create and then just
+// go around in a loop, so steady state does no allocation at all:
+//   free ring -> loader fills -> ready ring -> compute uses -> free ring
+// the loader is the only producer on ready and the only consumer on free,
+// the compute thread the other way round
+struct input_pipeline {
+    struct memory_pool* pool;   // only touched by create/destroy, never by the threads
+    struct spsc_ring ready;
+    struct spsc_ring free;
+
+    int rows;
+    int cols;
+    input_fill_fn fill;
+    void* ctx;
+
+    pthread_t loader;
+    _Atomic int stop;
+
+    _Atomic size_t batches_loaded;
+    _Atomic size_t loader_waits;    // times the loader found no free buffer
+    size_t compute_waits;           // times next() found nothing ready, compute thread only
+};
+
+// NULL if the pool, rings or thread can't be set up
+struct input_pipeline* input_pipeline_create(int rows, int cols, int depth,
+                                             input_fill_fn fill, void* ctx);
+// blocks until a filled batch is ready, the caller owns it until release
+float* input_pipeline_next(struct input_pipeline* pipe);
+void input_pipeline_release(struct input_pipeline* pipe, float* batch);
+// stops and joins the loader, then frees every buffer
+void input_pipeline_destroy(struct input_pipeline* pipe);
+
+#endif /* INPUT_PIPELINE_H */
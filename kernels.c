@@ -0,0 +1,171 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <time.h>
+#include "kernels.h"
+#include "threadArena.h"
+#include "trace.h"
+
+void matmul_generic(const float* a, const float* b, float* c, int m, int k, int n) {
+    //off of wikipedia just the easiest way
+    for (int i = 0; i < m; i++) {
+        for (int j = 0; j < n; j++) {
+            c[i * n + j] = 0;
+            for (int p = 0; p < k; p++) {
+                c[i * n + j] += a[i * k + p] * b[p * n + j];
+            }
+        }
+    }
+}
+
+matmul_kernel_fn matmul_kernel_find(const struct matmul_kernel* table, int count,
+                                    int m, int k, int n) {
+    // a handful of entries per model, a linear scan beats anything clever
+    for (int i = 0; i < count; i++) {
+        if (table[i].m == m && table[i].k == k && table[i].n == n) return table[i].fn;
+    }
+    return NULL;
+}
+
+size_t matmul_packed_size(int k, int n) {
+    int panels = (n + MATMUL_PANEL - 1) / MATMUL_PANEL;
+    return sizeof(float) * (size_t)panels * MATMUL_PANEL * k;
+}
+
+void matmul_pack_b(const float* b, int k, int n, int k_packed, float* packed) {
+    int panels = (n + MATMUL_PANEL - 1) / MATMUL_PANEL;
+    for (int p = 0; p < panels; p++) {
+        for (int row = 0; row < k_packed; row++) {
+            for (int jj = 0; jj < MATMUL_PANEL; jj++) {
+                int j = p * MATMUL_PANEL + jj;
+                *packed++ = row < k && j < n ? b[row * n + j] : 0.0f;
+            }
+        }
+    }
+}
+
+void pack_weight(struct scratch_arena* arena, Tensor* t, int rows) {
+    float* packed = scratch_arena_alloc(arena, matmul_packed_size(rows, t->cols));
+    if (!packed) {
+        printf("Failed to pack weights!\n");
+        exit(1);
+    }
+    matmul_pack_b((const float*)t->data, t->rows, t->cols, rows, packed);
+    t->data = packed;
+    t->rows = rows;
+    t->layout = LAYOUT_PACKED;
+}
+
+// rows x MATMUL_PANEL block of c, accumulated in registers. the panel row
+// is one contiguous line and each a element is broadcast across it
+static inline void packed_tile(const float* a, int k, const float* panel, float* c, int n,
+                               int rows, int cols) {
+    float acc[MATMUL_TILE_ROWS][MATMUL_PANEL] = {{0}};
+
+    for (int p = 0; p < k; p++) {
+        const float* b = panel + p * MATMUL_PANEL;
+        _Pragma("GCC unroll 4")
+        for (int r = 0; r < rows; r++) {
+            const float ar = a[r * k + p];
+            _Pragma("GCC unroll 16")
+            for (int jj = 0; jj < MATMUL_PANEL; jj++) acc[r][jj] += ar * b[jj];
+        }
+    }
+
+    for (int r = 0; r < rows; r++) {
+        for (int jj = 0; jj < cols; jj++) c[r * n + jj] = acc[r][jj];
+    }
+}
+
+void matmul_packed(const float* a, const float* packed, float* c, int m, int k, int n, int k_packed) {
+    for (int j0 = 0; j0 < n; j0 += MATMUL_PANEL) {
+        const float* panel = packed + (size_t)(j0 / MATMUL_PANEL) * k_packed * MATMUL_PANEL;
+        int cols = n - j0 < MATMUL_PANEL ? n - j0 : MATMUL_PANEL;
+
+        for (int i0 = 0; i0 < m; i0 += MATMUL_TILE_ROWS) {
+            // the full tile call gets a constant row count and unrolls completely
+            if (m - i0 >= MATMUL_TILE_ROWS) {
+                packed_tile(a + i0 * k, k, panel, c + i0 * n + j0, n, MATMUL_TILE_ROWS, cols);
+            } else {
+                packed_tile(a + i0 * k, k, panel, c + i0 * n + j0, n, m - i0, cols);
+            }
+        }
+    }
+}
+
+void kernels_matmul(const struct matmul_kernel* table, int count,
+                    const Tensor* A, const Tensor* B, Tensor* out) {
+    float* a = (float*)A->data;
+    float* b = (float*)B->data;
+    float* c = (float*)out->data;
+
+    TRACE_BEGIN("matmul");
+    matmul_kernel_fn kernel;
+    if (B->layout == LAYOUT_PACKED) {
+        matmul_packed(a, b, c, A->rows, A->cols, B->cols, B->rows);
+    } else if ((kernel = matmul_kernel_find(table, count, A->rows, A->cols, B->cols)) &&
+               out->cols == B->cols) {
+        kernel(a, b, c);
+    } else {
+        matmul_generic(a, b, c, A->rows, A->cols, B->cols);
+    }
+    TRACE_END("matmul");
+}
+
+static inline double kernel_now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+void kernels_benchmark(const struct matmul_kernel* table, int count) {
+    printf("\n--- MATMUL KERNELS ---\n");
+    for (int s = 0; s < count; s++) {
+        const struct matmul_kernel* kern = &table[s];
+        float* a = malloc(sizeof(float) * kern->m * kern->k);
+        float* b = malloc(sizeof(float) * kern->k * kern->n);
+        float* c = malloc(sizeof(float) * kern->m * kern->n);
+        float* packed = malloc(matmul_packed_size(kern->k, kern->n));
+        if (!a || !b || !c || !packed) {
+            printf("Failed to allocate kernel buffers!\n");
+            exit(1);
+        }
+        for (int i = 0; i < kern->m * kern->k; i++) a[i] = (float)rand() / (float)RAND_MAX;
+        for (int i = 0; i < kern->k * kern->n; i++) b[i] = (float)rand() / (float)RAND_MAX;
+        matmul_pack_b(b, kern->k, kern->n, kern->k, packed);
+
+        // about 100M multiply-adds per side whatever the shape
+        long reps = 100000000L / ((long)kern->m * kern->k * kern->n) + 1;
+        volatile float sink = 0;
+
+        double start = kernel_now();
+        for (long r = 0; r < reps; r++) {
+            matmul_generic(a, b, c, kern->m, kern->k, kern->n);
+            sink += c[r % (kern->m * kern->n)];
+        }
+        double generic_time = (kernel_now() - start) / reps;
+
+        start = kernel_now();
+        for (long r = 0; r < reps; r++) {
+            kern->fn(a, b, c);
+            sink += c[r % (kern->m * kern->n)];
+        }
+        double kernel_time = (kernel_now() - start) / reps;
+
+        start = kernel_now();
+        for (long r = 0; r < reps; r++) {
+            matmul_packed(a, packed, c, kern->m, kern->k, kern->n, kern->k);
+            sink += c[r % (kern->m * kern->n)];
+        }
+        double packed_time = (kernel_now() - start) / reps;
+        (void)sink;
+
+        printf("matmul %dx%dx%d: generic %.1f ns, specialized %.1f ns (%.2fx), packed %.1f ns (%.2fx)\n",
+               kern->m, kern->k, kern->n, generic_time * 1e9, kernel_time * 1e9,
+               generic_time / kernel_time, packed_time * 1e9, generic_time / packed_time);
+        free(packed);
+        free(a);
+        free(b);
+        free(c);
+    }
+}
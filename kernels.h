@@ -0,0 +1,91 @@
+#ifndef KERNELS_H
+#define KERNELS_H
+
+#include <stddef.h>
+
+struct scratch_arena;
+
+#define MATMUL_PANEL 16         // packed panel width, one 64 byte line of floats
+#define MATMUL_TILE_ROWS 4      // rows of A the packed kernel works on at once
+
+// how a weight tensor's floats are laid out
+enum tensor_layout {
+    LAYOUT_ROW_MAJOR,   // b[k * cols + j], what everything starts as
+    LAYOUT_PACKED,      // column panels from matmul_pack_b
+};
+
+typedef struct {
+    void* data;
+    int rows;
+    int cols;
+    enum tensor_layout layout;  // weights get packed at startup, activations stay row major
+} Tensor;
+
+// c = a * b for row major a[m][k], b[k][n], c[m][n]
+typedef void (*matmul_kernel_fn)(const float* restrict a, const float* restrict b, float* restrict c);
+
+struct matmul_kernel {
+    int m, k, n;
+    matmul_kernel_fn fn;
+};
+
+// stamps out matmul_MxKxN with every loop bound a compile time constant.
+// same i-k-j order and summation order as the generic loop, so results are
+// bit for bit identical, but now the compiler can fully unroll the tiny
+// shapes and vectorize the inner j loop on the big ones. the extra level
+// lets callers pass macros like BATCH_SIZE and still get 32x784x128 names
+#define MATMUL_KERNEL(M, K, N) MATMUL_KERNEL_IMPL(M, K, N)
+#define MATMUL_KERNEL_IMPL(M, K, N)                                                     \
+static void matmul_##M##x##K##x##N(const float* restrict a, const float* restrict b,   \
+                                   float* restrict c) {                                 \
+    for (int i = 0; i < (M); i++) {                                                     \
+        _Pragma("GCC unroll 8")                                                         \
+        for (int j = 0; j < (N); j++) c[i * (N) + j] = 0.0f;                            \
+        for (int k = 0; k < (K); k++) {                                                 \
+            const float aik = a[i * (K) + k];                                           \
+            _Pragma("GCC unroll 8")                                                     \
+            for (int j = 0; j < (N); j++) c[i * (N) + j] += aik * b[k * (N) + j];       \
+        }                                                                               \
+    }                                                                                   \
+}
+
+// table entry for a kernel made with MATMUL_KERNEL
+#define MATMUL_KERNEL_ENTRY(M, K, N) MATMUL_KERNEL_ENTRY_IMPL(M, K, N)
+#define MATMUL_KERNEL_ENTRY_IMPL(M, K, N) {(M), (K), (N), matmul_##M##x##K##x##N}
+
+// the runtime shaped loop everything falls back to. lives in kernels.c on
+// purpose so constant arguments can't quietly specialize it at the call site
+void matmul_generic(const float* a, const float* b, float* c, int m, int k, int n);
+
+// NULL when no kernel in the table matches the shape
+matmul_kernel_fn matmul_kernel_find(const struct matmul_kernel* table, int count,
+                                    int m, int k, int n);
+
+// bytes matmul_pack_b needs for a k x n matrix, n rounded up to whole panels
+size_t matmul_packed_size(int k, int n);
+
+// copies row major b (k x n) into panels of MATMUL_PANEL columns. panel p
+// holds columns [p*PANEL, p*PANEL + PANEL) for every row, one row after the
+// other, so the kernel reads it front to back. k_packed >= k pads the
+// bottom with zero rows, the ragged last panel is zero padded too
+void matmul_pack_b(const float* b, int k, int n, int k_packed, float* packed);
+
+// c = a * b with b packed by matmul_pack_b(..., k_packed, ...), k <= k_packed.
+// same summation order as matmul_generic, results are identical
+void matmul_packed(const float* a, const float* packed, float* c, int m, int k, int n, int k_packed);
+
+// copies t into arena in the panel layout matmul_packed reads front to
+// back and points t at it. rows can be more than t->rows, the extra ones
+// are zeros. exits if the arena can't hold it
+void pack_weight(struct scratch_arena* arena, Tensor* t, int rows);
+
+// out = A * B. a packed B goes to matmul_packed, a shape in the table to its
+// kernel, anything else to matmul_generic
+void kernels_matmul(const struct matmul_kernel* table, int count,
+                    const Tensor* A, const Tensor* B, Tensor* out);
+
+// times generic vs specialized vs packed on every shape in the table, on
+// private buffers so every shape has a properly sized b
+void kernels_benchmark(const struct matmul_kernel* table, int count);
+
+#endif /* KERNELS_H */
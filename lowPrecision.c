@@ -0,0 +1,180 @@
+#include <stdlib.h>
+#include <math.h>
+#include "lowPrecision.h"
+
+#define SCALE_ALIGN 16
+#define MIXED_TILE 256     // B columns widened at a time, 1KB of stack
+
+size_t dtype_size(enum tensor_dtype dtype) {
+    switch (dtype) {
+    case DTYPE_F32:  return 4;
+    case DTYPE_BF16: return 2;
+    case DTYPE_F16:  return 2;
+    case DTYPE_I8:   return 1;
+    }
+    return 0;
+}
+
+const char* dtype_name(enum tensor_dtype dtype) {
+    switch (dtype) {
+    case DTYPE_F32:  return "fp32";
+    case DTYPE_BF16: return "bf16";
+    case DTYPE_F16:  return "fp16";
+    case DTYPE_I8:   return "int8";
+    }
+    return "?";
+}
+
+static size_t data_bytes(enum tensor_dtype dtype, int rows, int cols) {
+    return dtype_size(dtype) * (size_t)rows * cols;
+}
+
+size_t qtensor_bytes(enum tensor_dtype dtype, int rows, int cols) {
+    size_t bytes = data_bytes(dtype, rows, cols);
+    if (dtype == DTYPE_I8) {
+        bytes = (bytes + SCALE_ALIGN - 1) & ~(size_t)(SCALE_ALIGN - 1);
+        bytes += sizeof(float) * cols;
+    }
+    return bytes;
+}
+
+void qtensor_init(struct qtensor* t, void* memory, int rows, int cols, enum tensor_dtype dtype) {
+    t->data = memory;
+    t->rows = rows;
+    t->cols = cols;
+    t->dtype = dtype;
+    t->scales = NULL;
+    if (dtype == DTYPE_I8) {
+        size_t offset = (data_bytes(dtype, rows, cols) + SCALE_ALIGN - 1) & ~(size_t)(SCALE_ALIGN - 1);
+        t->scales = (float*)((char*)memory + offset);
+    }
+}
+
+static void quantize_i8(struct qtensor* dst, const float* src) {
+    int8_t* q = dst->data;
+    int rows = dst->rows, cols = dst->cols;
+
+    for (int j = 0; j < cols; j++) {
+        float absmax = 0.0f;
+        for (int i = 0; i < rows; i++) {
+            float v = fabsf(src[i * cols + j]);
+            if (v > absmax) absmax = v;
+        }
+        // an all zero column still needs a usable scale
+        dst->scales[j] = absmax > 0.0f ? absmax / 127.0f : 1.0f;
+    }
+
+    for (int i = 0; i < rows; i++) {
+        for (int j = 0; j < cols; j++) {
+            float v = src[i * cols + j] / dst->scales[j];
+            int r = (int)(v + (v >= 0.0f ? 0.5f : -0.5f));
+            if (r > 127) r = 127;
+            if (r < -127) r = -127;
+            q[i * cols + j] = (int8_t)r;
+        }
+    }
+}
+
+void qtensor_from_f32(struct qtensor* dst, const float* src) {
+    size_t n = (size_t)dst->rows * dst->cols;
+    switch (dst->dtype) {
+    case DTYPE_F32:
+        memcpy(dst->data, src, n * sizeof(float));
+        break;
+    case DTYPE_BF16:
+        for (size_t i = 0; i < n; i++) ((uint16_t*)dst->data)[i] = f32_to_bf16(src[i]);
+        break;
+    case DTYPE_F16:
+        for (size_t i = 0; i < n; i++) ((uint16_t*)dst->data)[i] = f32_to_f16(src[i]);
+        break;
+    case DTYPE_I8:
+        quantize_i8(dst, src);
+        break;
+    }
+}
+
+void qtensor_to_f32(const struct qtensor* src, float* dst) {
+    size_t n = (size_t)src->rows * src->cols;
+    switch (src->dtype) {
+    case DTYPE_F32:
+        memcpy(dst, src->data, n * sizeof(float));
+        break;
+    case DTYPE_BF16:
+        for (size_t i = 0; i < n; i++) dst[i] = bf16_to_f32(((const uint16_t*)src->data)[i]);
+        break;
+    case DTYPE_F16:
+        for (size_t i = 0; i < n; i++) dst[i] = f16_to_f32(((const uint16_t*)src->data)[i]);
+        break;
+    case DTYPE_I8:
+        for (size_t i = 0; i < n; i++) {
+            dst[i] = ((const int8_t*)src->data)[i] * src->scales[i % src->cols];
+        }
+        break;
+    }
+}
+
+// one element of A, only called rows*cols times so a switch is fine
+static inline float qtensor_get(const struct qtensor* t, int i, int j) {
+    size_t idx = (size_t)i * t->cols + j;
+    switch (t->dtype) {
+    case DTYPE_F32:  return ((const float*)t->data)[idx];
+    case DTYPE_BF16: return bf16_to_f32(((const uint16_t*)t->data)[idx]);
+    case DTYPE_F16:  return f16_to_f32(((const uint16_t*)t->data)[idx]);
+    case DTYPE_I8:   return ((const int8_t*)t->data)[idx] * t->scales[j];
+    }
+    return 0.0f;
+}
+
+// columns [j0, j0 + n) of B's row k widened to fp32, int8 scales included
+static void load_row(const struct qtensor* B, int k, int j0, int n, float* restrict dst) {
+    size_t idx = (size_t)k * B->cols + j0;
+    switch (B->dtype) {
+    case DTYPE_F32:
+        memcpy(dst, (const float*)B->data + idx, n * sizeof(float));
+        break;
+    case DTYPE_BF16: {
+        const uint16_t* src = (const uint16_t*)B->data + idx;
+        for (int j = 0; j < n; j++) dst[j] = bf16_to_f32(src[j]);
+        break;
+    }
+    case DTYPE_F16: {
+        const uint16_t* src = (const uint16_t*)B->data + idx;
+        int j = 0;
+#ifdef __F16C__
+        // gcc won't vectorize the scalar intrinsic, do 8 at a time ourselves
+        for (; j + 8 <= n; j += 8) {
+            _mm256_storeu_ps(dst + j, _mm256_cvtph_ps(_mm_loadu_si128((const __m128i*)(src + j))));
+        }
+#endif
+        for (; j < n; j++) dst[j] = f16_to_f32(src[j]);
+        break;
+    }
+    case DTYPE_I8: {
+        const int8_t* src = (const int8_t*)B->data + idx;
+        for (int j = 0; j < n; j++) dst[j] = src[j] * B->scales[j0 + j];
+        break;
+    }
+    }
+}
+
+void matmul_mixed(const struct qtensor* A, const struct qtensor* B, float* out) {
+    int M = A->rows, K = A->cols, N = B->cols;
+    float tile[MIXED_TILE];
+
+    memset(out, 0, sizeof(float) * M * N);
+
+    // k outside i, so every row of B is read and widened once per call
+    // and then reused by all M rows of A, instead of streaming the whole
+    // weight matrix M times. per element it's still summed in k order
+    for (int j0 = 0; j0 < N; j0 += MIXED_TILE) {
+        int n = N - j0 < MIXED_TILE ? N - j0 : MIXED_TILE;
+        for (int k = 0; k < K; k++) {
+            load_row(B, k, j0, n, tile);
+            for (int i = 0; i < M; i++) {
+                float a = qtensor_get(A, i, k);
+                float* restrict acc = out + (size_t)i * N + j0;
+                for (int j = 0; j < n; j++) acc[j] += a * tile[j];
+            }
+        }
+    }
+}
@@ -0,0 +1,102 @@
+#ifndef LOW_PRECISION_H
+#define LOW_PRECISION_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#ifdef __F16C__
+#include <immintrin.h>
+#endif
+
+enum tensor_dtype {
+    DTYPE_F32,
+    DTYPE_BF16,
+    DTYPE_F16,
+    DTYPE_I8,       // symmetric, one fp32 scale per column (output channel)
+};
+
+// rows x cols stored as dtype. for DTYPE_I8 the scales live in the same
+// allocation, right after the data, so one block holds the whole tensor
+struct qtensor {
+    void* data;
+    float* scales;      // DTYPE_I8 only, NULL otherwise
+    int rows;
+    int cols;
+    enum tensor_dtype dtype;
+};
+
+size_t dtype_size(enum tensor_dtype dtype);
+const char* dtype_name(enum tensor_dtype dtype);
+
+// what to ask an allocator for, data plus scales when there are any
+size_t qtensor_bytes(enum tensor_dtype dtype, int rows, int cols);
+// lays a tensor over memory that is at least qtensor_bytes long
+void qtensor_init(struct qtensor* t, void* memory, int rows, int cols, enum tensor_dtype dtype);
+
+// rows*cols floats in or out. int8 picks each column's scale from its absmax
+void qtensor_from_f32(struct qtensor* dst, const float* src);
+void qtensor_to_f32(const struct qtensor* src, float* dst);
+
+// out = A * B as fp32, whatever A and B are stored as. products are
+// accumulated in fp32, only the loads are narrower
+void matmul_mixed(const struct qtensor* A, const struct qtensor* B, float* out);
+
+static inline uint32_t f32_bits(float f) { uint32_t u; memcpy(&u, &f, 4); return u; }
+static inline float bits_f32(uint32_t u) { float f; memcpy(&f, &u, 4); return f; }
+
+// bf16 is just the top half of a float, round to nearest even on the way down
+static inline uint16_t f32_to_bf16(float f) {
+    uint32_t u = f32_bits(f);
+    if ((u & 0x7fffffff) > 0x7f800000) return (uint16_t)((u >> 16) | 0x40);   // keep NaN a NaN
+    u += 0x7fff + ((u >> 16) & 1);
+    return (uint16_t)(u >> 16);
+}
+
+static inline float bf16_to_f32(uint16_t h) { return bits_f32((uint32_t)h << 16); }
+
+#ifdef __F16C__
+static inline uint16_t f32_to_f16(float f) { return _cvtss_sh(f, 0); }
+static inline float f16_to_f32(uint16_t h) { return _cvtsh_ss(h); }
+#else
+// no F16C, so do it with bit tricks (after Fabian Giesen's half<->float).
+// round to nearest even, handles subnormals, inf and NaN
+static inline uint16_t f32_to_f16(float f) {
+    const uint32_t f32_inf = 255u << 23;
+    const uint32_t f16_max = (127u + 16) << 23;
+    const float denorm_magic = bits_f32(((127u - 15) + (23 - 10) + 1) << 23);
+
+    uint32_t u = f32_bits(f);
+    uint32_t sign = u & 0x80000000u;
+    u ^= sign;
+
+    uint16_t o;
+    if (u >= f16_max) {
+        o = u > f32_inf ? 0x7e00 : 0x7c00;
+    } else if (u < (113u << 23)) {
+        // lands in f16 subnormal range, let the fpu do the rounding
+        o = (uint16_t)(f32_bits(bits_f32(u) + denorm_magic) - f32_bits(denorm_magic));
+    } else {
+        uint32_t mant_odd = (u >> 13) & 1;
+        u += ((uint32_t)(15 - 127) << 23) + 0xfff;
+        u += mant_odd;
+        o = (uint16_t)(u >> 13);
+    }
+    return o | (uint16_t)(sign >> 16);
+}
+
+static inline float f16_to_f32(uint16_t h) {
+    const uint32_t exp_mask = 0x7c00u << 13;
+    uint32_t o = (uint32_t)(h & 0x7fff) << 13;
+    uint32_t exp = o & exp_mask;
+    o += (uint32_t)(127 - 15) << 23;
+    if (exp == exp_mask) {
+        o += (uint32_t)(128 - 16) << 23;    // inf / NaN
+    } else if (exp == 0) {
+        o += 1u << 23;                      // subnormal, renormalize
+        o = f32_bits(bits_f32(o) - bits_f32(113u << 23));
+    }
+    return bits_f32(o | (uint32_t)(h & 0x8000) << 16);
+}
+#endif
+
+#endif /* LOW_PRECISION_H */
@@ -0,0 +1,543 @@
+// drop-in malloc replacement built on the slab/pool ideas in this repo:
+// small sizes come from per-size-class slabs with per-thread caches,
+// large ones get their own mmap. meant for
+//
+//   gcc -O2 -shared -fPIC -o libmyalloc.so mallocShim.c -pthread -ldl
+//   LD_PRELOAD=./libmyalloc.so ./service
+//
+// so RSS and throughput can be compared against glibc/jemalloc/tcmalloc
+// under real load. slabAllocator.c can't be reused directly because it gets
+// its own memory and metadata from malloc, so slabs here are carved from mmap.
+//
+// every slab is a SHIM_SPAN aligned chunk with a header in its first cache
+// line. a large allocation also puts a header on a SHIM_SPAN boundary right
+// below the pointer, so for any pointer we hand out (ptr - 1) rounded down to
+// SHIM_SPAN finds its header. a two level bitmap of every span that holds
+// one of our headers lets free() tell our pointers from foreign ones
+// without touching memory it doesn't own
+
+#define _GNU_SOURCE
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <sys/mman.h>
+#include <dlfcn.h>
+
+#define SHIM_SPAN ((size_t)64 * 1024)           // slab size and header alignment
+#define SHIM_REGION_SPANS 64                    // slabs reserved per mmap
+#define SHIM_HEADER 64                          // objects start one cache line in
+#define SHIM_MAGIC 0x5348494Du
+#define SHIM_SMALL_MAX 8192                     // above this, straight to mmap
+#define SHIM_NUM_CLASSES 32
+#define SHIM_TCACHE_MAX 64                      // per class, per thread
+#define SHIM_BATCH 32                           // objects moved between thread and global lists
+#define SHIM_LARGE_CACHE 16                     // freed large mappings kept for reuse
+#define SHIM_LARGE_CACHE_MAX ((size_t)4 << 20)  // bigger ones always go back to the OS
+#define SHIM_SPAN_SHIFT 16                      // log2(SHIM_SPAN)
+#define SHIM_MAP_LEAF_BITS 16                   // spans per leaf, 4GB of address space
+#define SHIM_MAP_ROOT_BITS (48 - SHIM_SPAN_SHIFT - SHIM_MAP_LEAF_BITS)
+
+enum shim_kind { SHIM_SLAB = 1, SHIM_LARGE = 2 };
+
+struct shim_header {
+    uint32_t magic;
+    uint32_t kind;
+    size_t obj_size;        // class size for slabs, usable bytes for large
+    void* map_base;         // large only, what to munmap
+    size_t map_len;
+    int zeroed;             // large only, fresh from mmap and never handed out before
+};
+
+struct shim_obj {
+    struct shim_obj* next;
+};
+
+// global state of one size class, only touched on thread cache miss/overflow
+struct shim_class {
+    atomic_flag lock;
+    struct shim_obj* free_list;
+    char* carve;            // never used tail of the newest slab, carved lazily
+    char* carve_end;
+};
+
+enum shim_tcache_state { TCACHE_NEW = 0, TCACHE_LIVE, TCACHE_DEAD };
+
+struct shim_tcache {
+    struct shim_obj* head[SHIM_NUM_CLASSES];
+    uint32_t count[SHIM_NUM_CLASSES];
+    int state;
+};
+
+static struct shim_class classes[SHIM_NUM_CLASSES];
+
+static atomic_flag region_lock = ATOMIC_FLAG_INIT;
+static char* region_next;
+static char* region_end;
+
+// munmap + mmap per large alloc is mostly syscall time, so a few freed
+// mappings are parked here and reused for requests of a similar size
+static atomic_flag large_lock = ATOMIC_FLAG_INIT;
+static struct {
+    void* base;
+    size_t len;
+} large_cache[SHIM_LARGE_CACHE];
+static int large_cached;
+
+// one bit per SHIM_SPAN of (48 bit) address space, set while the span
+// starts with one of our headers. leaves are mmapped on first use and never
+// freed, readers only need the pointer and one word
+struct shim_map_leaf {
+    _Atomic uint64_t bits[((size_t)1 << SHIM_MAP_LEAF_BITS) / 64];
+};
+static _Atomic(struct shim_map_leaf*) span_map[(size_t)1 << SHIM_MAP_ROOT_BITS];
+
+static __thread struct shim_tcache tcache __attribute__((tls_model("initial-exec")));
+static pthread_key_t tcache_key;
+static pthread_once_t tcache_once = PTHREAD_ONCE_INIT;
+
+static void lock(atomic_flag* l) {
+    int spins = 0;
+    while (atomic_flag_test_and_set_explicit(l, memory_order_acquire)) {
+        if (++spins > 64) {
+            sched_yield();
+            spins = 0;
+        }
+    }
+}
+
+static void unlock(atomic_flag* l) {
+    atomic_flag_clear_explicit(l, memory_order_release);
+}
+
+// 16..128 in steps of 16, then four classes per power of two up to 8KB
+static size_t class_size(int idx) {
+    if (idx < 8) return (size_t)16 * (idx + 1);
+    int j = idx - 8;
+    int k = 7 + j / 4;
+    return ((size_t)1 << k) + (size_t)(j % 4 + 1) * ((size_t)1 << (k - 2));
+}
+
+static int class_index(size_t size) {
+    if (size <= 128) return size ? (int)((size + 15) / 16) - 1 : 0;
+    int k = 63 - __builtin_clzll(size - 1);
+    size_t step = (size_t)1 << (k - 2);
+    size_t over = size - ((size_t)1 << k);
+    return 8 + (k - 7) * 4 + (int)((over + step - 1) / step) - 1;
+}
+
+static struct shim_header* header_of(const void* ptr) {
+    return (struct shim_header*)(((uintptr_t)ptr - 1) & ~(uintptr_t)(SHIM_SPAN - 1));
+}
+
+// false for anything outside the 48 bit space too, we never hand those out
+static int span_owned(const struct shim_header* h) {
+    uintptr_t span = (uintptr_t)h >> SHIM_SPAN_SHIFT;
+    if (span >> (SHIM_MAP_ROOT_BITS + SHIM_MAP_LEAF_BITS)) return 0;
+    struct shim_map_leaf* leaf = atomic_load_explicit(&span_map[span >> SHIM_MAP_LEAF_BITS],
+                                                      memory_order_acquire);
+    if (!leaf) return 0;
+    size_t bit = span & (((size_t)1 << SHIM_MAP_LEAF_BITS) - 1);
+    return (atomic_load_explicit(&leaf->bits[bit / 64], memory_order_relaxed) >> (bit % 64)) & 1;
+}
+
+// 0 on success, -1 if the span can't be tracked (no memory for a leaf)
+static int span_mark(const struct shim_header* h, int owned) {
+    uintptr_t span = (uintptr_t)h >> SHIM_SPAN_SHIFT;
+    if (span >> (SHIM_MAP_ROOT_BITS + SHIM_MAP_LEAF_BITS)) return -1;
+    _Atomic(struct shim_map_leaf*)* slot = &span_map[span >> SHIM_MAP_LEAF_BITS];
+    struct shim_map_leaf* leaf = atomic_load_explicit(slot, memory_order_acquire);
+    if (!leaf) {
+        if (!owned) return 0;
+        struct shim_map_leaf* fresh = mmap(NULL, sizeof(struct shim_map_leaf), PROT_READ | PROT_WRITE,
+                                           MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (fresh == MAP_FAILED) return -1;
+        // another thread may have raced us to the same leaf
+        if (atomic_compare_exchange_strong(slot, &leaf, fresh)) {
+            leaf = fresh;
+        } else {
+            munmap(fresh, sizeof(struct shim_map_leaf));
+        }
+    }
+    size_t bit = span & (((size_t)1 << SHIM_MAP_LEAF_BITS) - 1);
+    uint64_t mask = (uint64_t)1 << (bit % 64);
+    if (owned) {
+        atomic_fetch_or_explicit(&leaf->bits[bit / 64], mask, memory_order_release);
+    } else {
+        atomic_fetch_and_explicit(&leaf->bits[bit / 64], ~mask, memory_order_release);
+    }
+    return 0;
+}
+
+static void* map_aligned(size_t len, size_t align, void** base, size_t* base_len) {
+    size_t total = len + align;
+    char* p = mmap(NULL, total, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED) return NULL;
+    *base = p;
+    *base_len = total;
+    return (void*)(((uintptr_t)p + align - 1) & ~(uintptr_t)(align - 1));
+}
+
+static char* span_alloc() {
+    lock(&region_lock);
+    if (region_next == region_end) {
+        void* base;
+        size_t base_len;
+        char* r = map_aligned(SHIM_REGION_SPANS * SHIM_SPAN, SHIM_SPAN, &base, &base_len);
+        if (!r) {
+            unlock(&region_lock);
+            return NULL;
+        }
+        // hand the alignment slack back, the region itself stays mapped forever
+        char* head = base;
+        char* tail = r + SHIM_REGION_SPANS * SHIM_SPAN;
+        if (r > head) munmap(head, r - head);
+        if (head + base_len > tail) munmap(tail, head + base_len - tail);
+        region_next = r;
+        region_end = tail;
+    }
+    char* span = region_next;
+    region_next += SHIM_SPAN;
+    unlock(&region_lock);
+    return span;
+}
+
+// moves up to SHIM_BATCH objects of class idx into the thread cache
+static int refill(int idx) {
+    struct shim_class* c = &classes[idx];
+    size_t size = class_size(idx);
+    int moved = 0;
+
+    lock(&c->lock);
+    while (moved < SHIM_BATCH) {
+        struct shim_obj* obj = c->free_list;
+        if (obj) {
+            c->free_list = obj->next;
+        } else {
+            if (c->carve + size > c->carve_end) {
+                if (moved) break;
+                char* span = span_alloc();
+                if (!span) break;
+                struct shim_header* h = (struct shim_header*)span;
+                if (span_mark(h, 1) != 0) break;    // leaks the span, we're out of memory anyway
+                h->magic = SHIM_MAGIC;
+                h->kind = SHIM_SLAB;
+                h->obj_size = size;
+                c->carve = span + SHIM_HEADER;
+                c->carve_end = span + SHIM_SPAN;
+            }
+            obj = (struct shim_obj*)c->carve;
+            c->carve += size;
+        }
+        obj->next = tcache.head[idx];
+        tcache.head[idx] = obj;
+        moved++;
+    }
+    unlock(&c->lock);
+
+    tcache.count[idx] += moved;
+    return moved;
+}
+
+// gives the n oldest objects in the thread cache back to the class,
+// the recently freed (cache hot) ones stay with the thread
+static void flush(struct shim_tcache* tc, int idx, uint32_t n) {
+    if (!n) return;
+    uint32_t keep = tc->count[idx] - n;
+    struct shim_obj* first;
+    if (keep == 0) {
+        first = tc->head[idx];
+        tc->head[idx] = NULL;
+    } else {
+        struct shim_obj* cut = tc->head[idx];
+        for (uint32_t i = 1; i < keep; i++) cut = cut->next;
+        first = cut->next;
+        cut->next = NULL;
+    }
+    tc->count[idx] = keep;
+
+    struct shim_obj* last = first;
+    while (last->next) last = last->next;
+
+    struct shim_class* c = &classes[idx];
+    lock(&c->lock);
+    last->next = c->free_list;
+    c->free_list = first;
+    unlock(&c->lock);
+}
+
+// frees after this (later TLS destructors) go straight to the classes
+static void tcache_destroy(void* arg) {
+    struct shim_tcache* tc = arg;
+    for (int i = 0; i < SHIM_NUM_CLASSES; i++) flush(tc, i, tc->count[i]);
+    tc->state = TCACHE_DEAD;
+}
+
+static void tcache_key_init() {
+    pthread_key_create(&tcache_key, tcache_destroy);
+}
+
+// so a thread's cached objects go back to the classes when it exits.
+// both malloc and free call this, a thread that only ever frees (the
+// consumer side of a queue) fills its cache just the same.
+// pthread_setspecific may malloc, which is fine since we hold no locks here
+static void tcache_register() {
+    tcache.state = TCACHE_LIVE;
+    pthread_once(&tcache_once, tcache_key_init);
+    pthread_setspecific(tcache_key, &tcache);
+}
+
+static void* small_alloc(int idx) {
+    // after the destructor ran this registers again, pthreads then runs
+    // it once more so whatever we refill now is still flushed
+    if (tcache.state != TCACHE_LIVE) tcache_register();
+
+    struct shim_obj* obj = tcache.head[idx];
+    if (!obj) {
+        if (!refill(idx)) return NULL;
+        obj = tcache.head[idx];
+    }
+    tcache.head[idx] = obj->next;
+    tcache.count[idx]--;
+    return obj;
+}
+
+static void* large_alloc(size_t size, size_t align) {
+    if (align < 16) align = 16;
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t offset = (SHIM_HEADER + align - 1) & ~(align - 1);
+    if (size > SIZE_MAX - offset - SHIM_SPAN - align) return NULL;
+    size_t len = (offset + size + page - 1) & ~(page - 1);
+
+    void* base = NULL;
+    size_t base_len = 0;
+    size_t want = len + align + SHIM_SPAN;     // what map_aligned would map
+    int zeroed = 0;
+
+    lock(&large_lock);
+    for (int i = 0; i < large_cached; i++) {
+        if (large_cache[i].len >= want && large_cache[i].len <= 2 * want) {
+            base = large_cache[i].base;
+            base_len = large_cache[i].len;
+            large_cache[i] = large_cache[--large_cached];
+            break;
+        }
+    }
+    unlock(&large_lock);
+
+    char* start;
+    if (base) {
+        start = (char*)(((uintptr_t)base + SHIM_SPAN - 1) & ~(uintptr_t)(SHIM_SPAN - 1));
+    } else {
+        start = map_aligned(len + align, SHIM_SPAN, &base, &base_len);
+        if (!start) return NULL;
+        zeroed = 1;
+    }
+
+    char* ptr = (char*)(((uintptr_t)start + offset + align - 1) & ~(uintptr_t)(align - 1));
+    struct shim_header* h = header_of(ptr);
+    if (span_mark(h, 1) != 0) {
+        munmap(base, base_len);
+        return NULL;
+    }
+    h->magic = SHIM_MAGIC;
+    h->kind = SHIM_LARGE;
+    h->obj_size = (size_t)((char*)base + base_len - ptr);
+    h->map_base = base;
+    h->map_len = base_len;
+    h->zeroed = zeroed;
+    return ptr;
+}
+
+static void* aligned_alloc_impl(size_t align, size_t size) {
+    if (align <= 16) {
+        if (size <= SHIM_SMALL_MAX) return small_alloc(class_index(size));
+        return large_alloc(size, 16);
+    }
+
+    // slab objects start at SHIM_HEADER, so any class that is a multiple of
+    // align gives aligned objects as long as align divides SHIM_HEADER
+    if (align <= SHIM_HEADER && size <= SHIM_SMALL_MAX) {
+        for (int idx = class_index(size); idx < SHIM_NUM_CLASSES; idx++) {
+            if (class_size(idx) % align == 0) return small_alloc(idx);
+        }
+    }
+    return large_alloc(size, align);
+}
+
+void* malloc(size_t size) {
+    void* ptr = aligned_alloc_impl(16, size);
+    if (!ptr) errno = ENOMEM;
+    return ptr;
+}
+
+void free(void* ptr) {
+    if (!ptr) return;
+
+    struct shim_header* h = header_of(ptr);
+    if (!span_owned(h)) return;     // not ours, nothing sane to do with it
+
+    if (h->kind == SHIM_LARGE) {
+        // cached mappings aren't ours either until large_alloc hands them out again
+        void* base = h->map_base;
+        size_t len = h->map_len;
+        span_mark(h, 0);
+        if (len <= SHIM_LARGE_CACHE_MAX) {
+            lock(&large_lock);
+            if (large_cached < SHIM_LARGE_CACHE) {
+                large_cache[large_cached].base = base;
+                large_cache[large_cached].len = len;
+                large_cached++;
+                unlock(&large_lock);
+                return;
+            }
+            unlock(&large_lock);
+        }
+        munmap(base, len);
+        return;
+    }
+
+    int idx = class_index(h->obj_size);
+    struct shim_obj* obj = ptr;
+    if (tcache.state != TCACHE_LIVE) {
+        if (tcache.state == TCACHE_DEAD) {
+            struct shim_class* c = &classes[idx];
+            lock(&c->lock);
+            obj->next = c->free_list;
+            c->free_list = obj;
+            unlock(&c->lock);
+            return;
+        }
+        tcache_register();
+    }
+    obj->next = tcache.head[idx];
+    tcache.head[idx] = obj;
+    if (++tcache.count[idx] > SHIM_TCACHE_MAX) flush(&tcache, idx, SHIM_TCACHE_MAX / 2);
+}
+
+size_t malloc_usable_size(void* ptr) {
+    if (!ptr) return 0;
+    struct shim_header* h = header_of(ptr);
+    if (!span_owned(h)) return 0;
+    return h->obj_size;
+}
+
+void* calloc(size_t n, size_t size) {
+    size_t total;
+    if (__builtin_mul_overflow(n, size, &total)) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    // not malloc(): gcc folds malloc + memset back into a call to calloc
+    void* ptr = aligned_alloc_impl(16, total);
+    if (!ptr) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    // fresh mmap pages are already zero
+    struct shim_header* h = header_of(ptr);
+    if (h->kind != SHIM_LARGE || !h->zeroed) memset(ptr, 0, total);
+    return ptr;
+}
+
+// the allocator after us in link order (glibc normally), for blocks it
+// handed out before the preload took over. abort if there is none, any
+// answer we'd make up would lose the caller's data
+static void* next_symbol(const char* name) {
+    void* fn = dlsym(RTLD_NEXT, name);
+    if (!fn) {
+        static const char msg[] = "libmyalloc: realloc of a block that isn't ours and no allocator to hand it to\n";
+        if (write(STDERR_FILENO, msg, sizeof(msg) - 1) < 0) {}
+        abort();
+    }
+    return fn;
+}
+
+// moves a foreign block into one of ours, the old one goes back to its owner
+static void* realloc_foreign(void* ptr, size_t size) {
+    static size_t (*next_usable_size)(void*);
+    static void (*next_free)(void*);
+    if (!next_usable_size) next_usable_size = (size_t (*)(void*))next_symbol("malloc_usable_size");
+    if (!next_free) next_free = (void (*)(void*))next_symbol("free");
+
+    size_t usable = next_usable_size(ptr);
+    void* fresh = malloc(size);
+    if (!fresh) return NULL;
+    memcpy(fresh, ptr, size < usable ? size : usable);
+    next_free(ptr);
+    return fresh;
+}
+
+void* realloc(void* ptr, size_t size) {
+    if (!ptr) return malloc(size);
+    if (!span_owned(header_of(ptr))) return realloc_foreign(ptr, size);
+    if (size == 0) {
+        free(ptr);
+        return NULL;
+    }
+
+    size_t usable = malloc_usable_size(ptr);
+    // shrinking a lot is worth a copy, anything else stays put
+    if (size <= usable && size >= usable / 2) return ptr;
+
+    void* fresh = malloc(size);
+    if (!fresh) return NULL;
+    memcpy(fresh, ptr, size < usable ? size : usable);
+    free(ptr);
+    return fresh;
+}
+
+int posix_memalign(void** memptr, size_t align, size_t size) {
+    if (align < sizeof(void*) || (align & (align - 1))) return EINVAL;
+    void* ptr = aligned_alloc_impl(align, size);
+    if (!ptr) return ENOMEM;
+    *memptr = ptr;
+    return 0;
+}
+
+// glibc routes these through its own heap, they have to be ours too or
+// free() would get pointers it doesn't know
+void* aligned_alloc(size_t align, size_t size) {
+    if (align == 0 || (align & (align - 1))) {
+        errno = EINVAL;
+        return NULL;
+    }
+    void* ptr = aligned_alloc_impl(align, size);
+    if (!ptr) errno = ENOMEM;
+    return ptr;
+}
+
+void* memalign(size_t align, size_t size) {
+    return aligned_alloc(align, size);
+}
+
+void* valloc(size_t size) {
+    return aligned_alloc((size_t)sysconf(_SC_PAGESIZE), size);
+}
+
+void* pvalloc(size_t size) {
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    return aligned_alloc(page, (size + page - 1) & ~(page - 1));
+}
+
+// a child of fork must not inherit a lock some other thread was holding
+static void shim_prefork() {
+    lock(&region_lock);
+    lock(&large_lock);
+    for (int i = 0; i < SHIM_NUM_CLASSES; i++) lock(&classes[i].lock);
+}
+
+static void shim_postfork() {
+    for (int i = SHIM_NUM_CLASSES - 1; i >= 0; i--) unlock(&classes[i].lock);
+    unlock(&large_lock);
+    unlock(&region_lock);
+}
+
+__attribute__((constructor)) static void shim_init() {
+    pthread_atfork(shim_prefork, shim_postfork, shim_postfork);
+}
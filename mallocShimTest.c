@@ -0,0 +1,82 @@
+// regression tests for the malloc shim, run with it preloaded:
+//
+//   make check
+//   (LD_PRELOAD=./libmyalloc.so ./mallocShimTest)
+//
+// the foreign realloc case needs a block the shim never saw, so it asks
+// libc's own malloc for one directly
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dlfcn.h>
+
+static int failures = 0;
+
+static void check(int ok, const char* what) {
+    printf("%s: %s\n", ok ? "PASS" : "FAIL", what);
+    if (!ok) failures++;
+}
+
+static void fill(unsigned char* p, size_t n, unsigned char seed) {
+    for (size_t i = 0; i < n; i++) p[i] = (unsigned char)(seed + i * 7);
+}
+
+static int intact(const unsigned char* p, size_t n, unsigned char seed) {
+    for (size_t i = 0; i < n; i++) {
+        if (p[i] != (unsigned char)(seed + i * 7)) return 0;
+    }
+    return 1;
+}
+
+// realloc of our own blocks, growing across size classes and into the large path
+static void test_realloc_owned(void) {
+    size_t sizes[] = { 24, 100, 700, 4000, 100000, 50 };
+    size_t n = sizeof(sizes) / sizeof(sizes[0]);
+
+    unsigned char* p = malloc(sizes[0]);
+    fill(p, sizes[0], 3);
+    int ok = 1;
+    for (size_t i = 1; i < n; i++) {
+        size_t keep = sizes[i - 1] < sizes[i] ? sizes[i - 1] : sizes[i];
+        p = realloc(p, sizes[i]);
+        if (!p || !intact(p, keep, 3)) {
+            ok = 0;
+            break;
+        }
+        fill(p, sizes[i], 3);
+    }
+    free(p);
+    check(ok, "realloc keeps data across shim size classes");
+}
+
+// a block from libc's malloc, handed to the shim's realloc
+static void test_realloc_foreign(void) {
+    void* libc = dlopen("libc.so.6", RTLD_NOW | RTLD_NOLOAD);
+    void* (*libc_malloc)(size_t) = libc ? (void* (*)(size_t))dlsym(libc, "malloc") : NULL;
+    if (!libc_malloc || libc_malloc == malloc) {
+        printf("SKIP: foreign realloc, shim isn't preloaded\n");
+        return;
+    }
+
+    size_t n = 300;
+    unsigned char* p = libc_malloc(n);
+    fill(p, n, 11);
+    p = realloc(p, 5000);
+    check(p && intact(p, n, 11), "realloc keeps data of a block the shim didn't allocate");
+    free(p);
+
+    p = libc_malloc(n);
+    fill(p, n, 29);
+    p = realloc(p, 40);
+    check(p && intact(p, 40, 29), "realloc shrinks a block the shim didn't allocate");
+    free(p);
+    dlclose(libc);
+}
+
+int main(void) {
+    test_realloc_owned();
+    test_realloc_foreign();
+    return failures ? 1 : 0;
+}
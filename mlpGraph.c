@@ -0,0 +1,144 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "mlpGraph.h"
+#include "kernels.h"
+#include "trace.h"
+
+#define PLAN_ALIGN 16   // scratch_arena_alloc's alignment, padding per buffer
+
+void mlp_graph_init(struct mlp_graph* g, int input_dim) {
+    memset(g, 0, sizeof(*g));
+    g->input_dim = input_dim;
+}
+
+int mlp_graph_add_dense(struct mlp_graph* g, const char* name, int out_dim,
+                        const float* weights, const float* bias, int relu) {
+    if (g->num_layers == MLP_MAX_LAYERS) return -1;
+
+    struct mlp_layer* layer = &g->layers[g->num_layers];
+    layer->name = name;
+    layer->in_dim = g->num_layers ? g->layers[g->num_layers - 1].out_dim : g->input_dim;
+    layer->out_dim = out_dim;
+    layer->weights = weights;
+    layer->bias = bias;
+    layer->relu = relu;
+    g->num_layers++;
+    return 0;
+}
+
+static void* plan_alloc(struct mlp_plan* plan, size_t bytes) {
+    return scratch_arena_alloc(&plan->arena, bytes);
+}
+
+struct mlp_plan* mlp_plan_compile(const struct mlp_graph* g, int batch, int flags) {
+    if (g->num_layers == 0 || batch <= 0) return NULL;
+
+    // size the arena exactly first, so building the plan never spills
+    int widest = 0;
+    size_t bytes = sizeof(float) * batch * g->input_dim + PLAN_ALIGN;
+    for (int i = 0; i < g->num_layers; i++) {
+        const struct mlp_layer* layer = &g->layers[i];
+        if (layer->out_dim > widest) widest = layer->out_dim;
+        bytes += matmul_packed_size(layer->in_dim, layer->out_dim) + PLAN_ALIGN;
+        bytes += sizeof(float) * layer->out_dim + PLAN_ALIGN;
+    }
+    bytes += 2 * (sizeof(float) * batch * widest + PLAN_ALIGN);
+
+    struct mlp_plan* plan = malloc(sizeof(struct mlp_plan));
+    if (!plan) return NULL;
+    memset(plan, 0, sizeof(*plan));
+    if (!scratch_arena_init(&plan->arena, bytes)) {
+        free(plan);
+        return NULL;
+    }
+    plan->batch = batch;
+    plan->flags = flags;
+    plan->num_steps = g->num_layers;
+
+    plan->input = plan_alloc(plan, sizeof(float) * batch * g->input_dim);
+    float* ping = plan_alloc(plan, sizeof(float) * batch * widest);
+    float* pong = plan_alloc(plan, sizeof(float) * batch * widest);
+
+    const float* src = plan->input;
+    for (int i = 0; i < g->num_layers; i++) {
+        const struct mlp_layer* layer = &g->layers[i];
+        struct plan_step* step = &plan->steps[i];
+
+        float* packed = plan_alloc(plan, matmul_packed_size(layer->in_dim, layer->out_dim));
+        float* bias = plan_alloc(plan, sizeof(float) * layer->out_dim);
+        matmul_pack_b(layer->weights, layer->in_dim, layer->out_dim, layer->in_dim, packed);
+        memcpy(bias, layer->bias, sizeof(float) * layer->out_dim);
+
+        step->name = layer->name;
+        step->in_dim = layer->in_dim;
+        step->out_dim = layer->out_dim;
+        step->packed = packed;
+        step->bias = bias;
+        step->relu = layer->relu;
+        step->src = src;
+        step->dst = (i & 1) ? pong : ping;
+        src = step->dst;
+    }
+    plan->output = src;
+    return plan;
+}
+
+static inline double plan_now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void run_step(const struct plan_step* step, int batch) {
+    TRACE_BEGIN("matmul");
+    matmul_packed(step->src, step->packed, step->dst, batch, step->in_dim, step->out_dim, step->in_dim);
+    TRACE_END("matmul");
+
+    // bias and relu while the output tile is still in cache
+    TRACE_BEGIN("bias_relu");
+    for (int i = 0; i < batch; i++) {
+        float* row = step->dst + (size_t)i * step->out_dim;
+        for (int j = 0; j < step->out_dim; j++) {
+            float v = row[j] + step->bias[j];
+            row[j] = step->relu && v < 0.0f ? 0.0f : v;
+        }
+    }
+    TRACE_END("bias_relu");
+}
+
+const float* mlp_plan_run(struct mlp_plan* plan) {
+    if (!(plan->flags & MLP_PLAN_TIMING)) {
+        for (int i = 0; i < plan->num_steps; i++) run_step(&plan->steps[i], plan->batch);
+        return plan->output;
+    }
+
+    for (int i = 0; i < plan->num_steps; i++) {
+        struct plan_step* step = &plan->steps[i];
+        double start = plan_now();
+        run_step(step, plan->batch);
+        step->seconds += plan_now() - start;
+        step->runs++;
+    }
+    return plan->output;
+}
+
+void mlp_plan_print_timing(const struct mlp_plan* plan) {
+    double total = 0.0;
+    for (int i = 0; i < plan->num_steps; i++) total += plan->steps[i].seconds;
+
+    printf("Plan per-layer timing (batch %d, arena %zu bytes):\n", plan->batch, plan->arena.capacity);
+    for (int i = 0; i < plan->num_steps; i++) {
+        const struct plan_step* step = &plan->steps[i];
+        if (!step->runs) continue;
+        printf("  %-8s %4dx%-4d avg %10.1f ns  %5.1f%%\n", step->name, step->in_dim, step->out_dim,
+               step->seconds / step->runs * 1e9, total > 0.0 ? 100.0 * step->seconds / total : 0.0);
+    }
+}
+
+void mlp_plan_destroy(struct mlp_plan* plan) {
+    if (!plan) return;
+    scratch_arena_destroy(&plan->arena);
+    free(plan);
+}
@@ -0,0 +1,74 @@
+#ifndef MLP_GRAPH_H
+#define MLP_GRAPH_H
+
+#include <stdint.h>
+#include "threadArena.h"
+
+#define MLP_MAX_LAYERS 16
+
+// y = x * W + b, then relu if asked. W is in_dim x out_dim row major and
+// may have more rows than in_dim, only the first in_dim get used
+struct mlp_layer {
+    const char* name;
+    int in_dim;
+    int out_dim;
+    const float* weights;
+    const float* bias;
+    int relu;
+};
+
+// the model as data: just a list of layers, each one's input width is
+// the previous one's output width
+struct mlp_graph {
+    int input_dim;
+    int num_layers;
+    struct mlp_layer layers[MLP_MAX_LAYERS];
+};
+
+// one layer resolved against real buffers, nothing left to decide at run time
+struct plan_step {
+    const char* name;
+    int in_dim;
+    int out_dim;
+    const float* packed;    // weights in matmul_pack_b panels
+    const float* bias;
+    int relu;
+    const float* src;
+    float* dst;
+
+    double seconds;         // per layer totals, only with MLP_PLAN_TIMING
+    uint64_t runs;
+};
+
+// two clock reads per layer per run, so leave it off for the runs you
+// benchmark. plan->flags can be flipped between runs
+#define MLP_PLAN_TIMING 1
+
+// everything a forward pass touches lives in one arena that is sized at
+// compile time: packed weights, biases and the activation buffers.
+// activations ping-pong between two buffers as wide as the widest layer,
+// since a layer's input is dead as soon as its output is written
+struct mlp_plan {
+    int batch;
+    int num_steps;
+    int flags;
+    struct plan_step steps[MLP_MAX_LAYERS];
+    float* input;           // batch x input_dim, the caller fills it before run
+    const float* output;    // batch x last out_dim, valid after run
+    struct scratch_arena arena;
+};
+
+void mlp_graph_init(struct mlp_graph* g, int input_dim);
+// 0 on success, -1 if the graph is full
+int mlp_graph_add_dense(struct mlp_graph* g, const char* name, int out_dim,
+                        const float* weights, const float* bias, int relu);
+
+// NULL if the graph is empty or memory runs out
+struct mlp_plan* mlp_plan_compile(const struct mlp_graph* g, int batch, int flags);
+// replays the plan on plan->input without allocating anything, whatever
+// the model looks like it's the same loop over steps
+const float* mlp_plan_run(struct mlp_plan* plan);
+void mlp_plan_print_timing(const struct mlp_plan* plan);
+void mlp_plan_destroy(struct mlp_plan* plan);
+
+#endif /* MLP_GRAPH_H */
@@ -0,0 +1,195 @@
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include "perfCounters.h"
+
+static const char* counter_names[PERF_NUM_COUNTERS] = {
+    "cycles", "instructions", "cache-references", "cache-misses", "dTLB-load-misses"
+};
+
+#ifdef __linux__
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+static int open_counter(uint32_t type, uint64_t config) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;    // paranoid level 2 only lets us count user space
+    attr.exclude_hv = 1;
+    // the kernel multiplexes when we ask for more counters than the PMU has,
+    // these two let us scale the raw count back up
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+void perf_counters_open(struct perf_counters* pc) {
+    memset(pc, 0, sizeof(*pc));
+
+    pc->fds[PERF_CYCLES] = open_counter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+    pc->fds[PERF_INSTRUCTIONS] = open_counter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+    pc->fds[PERF_CACHE_REFERENCES] = open_counter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_REFERENCES);
+    pc->fds[PERF_CACHE_MISSES] = open_counter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+    pc->fds[PERF_DTLB_MISSES] = open_counter(PERF_TYPE_HW_CACHE,
+            PERF_COUNT_HW_CACHE_DTLB |
+            (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+            (PERF_COUNT_HW_CACHE_RESULT_MISS << 16));
+
+    for (int i = 0; i < PERF_NUM_COUNTERS; i++) {
+        if (pc->fds[i] >= 0) {
+            pc->available = 1;
+        } else {
+            pc->fds[i] = -1;
+        }
+    }
+
+    if (!pc->available) {
+        fprintf(stderr, "perf_event_open unavailable, reporting wall time only\n");
+    }
+}
+
+void perf_counters_start(struct perf_counters* pc) {
+    if (!pc->available) return;
+
+    for (int i = 0; i < PERF_NUM_COUNTERS; i++) {
+        if (pc->fds[i] < 0) continue;
+        ioctl(pc->fds[i], PERF_EVENT_IOC_RESET, 0);
+        ioctl(pc->fds[i], PERF_EVENT_IOC_ENABLE, 0);
+    }
+}
+
+void perf_counters_stop(struct perf_counters* pc) {
+    if (!pc->available) return;
+
+    for (int i = 0; i < PERF_NUM_COUNTERS; i++) {
+        if (pc->fds[i] >= 0) ioctl(pc->fds[i], PERF_EVENT_IOC_DISABLE, 0);
+    }
+
+    for (int i = 0; i < PERF_NUM_COUNTERS; i++) {
+        pc->values[i] = 0;
+        if (pc->fds[i] < 0) continue;
+
+        uint64_t buf[3]; // value, time_enabled, time_running
+        if (read(pc->fds[i], buf, sizeof(buf)) != sizeof(buf)) continue;
+
+        if (buf[2] == 0) continue; // never got scheduled on the PMU
+        if (buf[2] < buf[1]) {
+            pc->values[i] = (uint64_t)((double)buf[0] * buf[1] / buf[2]);
+        } else {
+            pc->values[i] = buf[0];
+        }
+    }
+}
+
+void perf_counters_close(struct perf_counters* pc) {
+    for (int i = 0; i < PERF_NUM_COUNTERS; i++) {
+        if (pc->fds[i] >= 0) close(pc->fds[i]);
+        pc->fds[i] = -1;
+    }
+    pc->available = 0;
+}
+
+#else
+
+void perf_counters_open(struct perf_counters* pc) {
+    memset(pc, 0, sizeof(*pc));
+    for (int i = 0; i < PERF_NUM_COUNTERS; i++) pc->fds[i] = -1;
+    fprintf(stderr, "perf counters need linux, reporting wall time only\n");
+}
+
+void perf_counters_start(struct perf_counters* pc) { (void)pc; }
+void perf_counters_stop(struct perf_counters* pc) { (void)pc; }
+void perf_counters_close(struct perf_counters* pc) { (void)pc; }
+
+#endif
+
+void perf_totals_add(struct perf_totals* totals, const struct perf_counters* pc) {
+    if (!pc->available) return;
+
+    for (int i = 0; i < PERF_NUM_COUNTERS; i++) {
+        if (pc->fds[i] < 0) continue;
+        totals->values[i] += pc->values[i];
+        totals->valid[i] = 1;
+    }
+    totals->runs++;
+}
+
+void perf_totals_print(const char* label, const struct perf_totals* totals) {
+    if (totals->runs == 0) return;
+
+    double runs = (double)totals->runs;
+    printf("%s counters (avg per run):\n", label);
+    for (int i = 0; i < PERF_NUM_COUNTERS; i++) {
+        if (!totals->valid[i]) continue;
+        printf("  %-18s %14.0f\n", counter_names[i], totals->values[i] / runs);
+    }
+
+    if (totals->valid[PERF_CYCLES] && totals->valid[PERF_INSTRUCTIONS] &&
+        totals->values[PERF_CYCLES]) {
+        printf("  %-18s %14.3f\n", "IPC",
+               (double)totals->values[PERF_INSTRUCTIONS] / totals->values[PERF_CYCLES]);
+    }
+    if (totals->valid[PERF_CACHE_MISSES] && totals->valid[PERF_CACHE_REFERENCES] &&
+        totals->values[PERF_CACHE_REFERENCES]) {
+        printf("  %-18s %13.2f%%\n", "cache miss rate",
+               100.0 * totals->values[PERF_CACHE_MISSES] / totals->values[PERF_CACHE_REFERENCES]);
+    }
+    if (totals->valid[PERF_DTLB_MISSES] && totals->valid[PERF_INSTRUCTIONS] &&
+        totals->values[PERF_INSTRUCTIONS]) {
+        printf("  %-18s %14.3f\n", "dTLB MPKI",
+               1000.0 * totals->values[PERF_DTLB_MISSES] / totals->values[PERF_INSTRUCTIONS]);
+    }
+}
+
+#define PERF_MAX_SECTIONS 16
+
+// reads back what perf_mode_compare wrote, 0 if there's no file
+static int load_mode_times(const char* path, char labels[][64], double* seconds) {
+    FILE* f = fopen(path, "r");
+    if (!f) return 0;
+
+    int n = 0;
+    while (n < PERF_MAX_SECTIONS && fscanf(f, " %63[^\t]\t%lf", labels[n], &seconds[n]) == 2) n++;
+    fclose(f);
+    return n;
+}
+
+void perf_mode_compare(const char* bench, int debug, const char* const* labels,
+                       const double* seconds, int n) {
+    char path[256];
+    snprintf(path, sizeof(path), "%s.%s.times", bench, debug ? "debug" : "release");
+    FILE* f = fopen(path, "w");
+    if (f) {
+        for (int i = 0; i < n; i++) fprintf(f, "%s\t%.9f\n", labels[i], seconds[i]);
+        fclose(f);
+    }
+
+    char other_labels[PERF_MAX_SECTIONS][64];
+    double other[PERF_MAX_SECTIONS];
+    snprintf(path, sizeof(path), "%s.%s.times", bench, debug ? "release" : "debug");
+    int other_n = load_mode_times(path, other_labels, other);
+    if (!other_n) {
+        printf("\nNo %s run of %s yet, rebuild %s -DALLOC_DEBUG and rerun to see the debug overhead\n",
+               debug ? "release" : "debug", bench, debug ? "without" : "with");
+        return;
+    }
+
+    printf("\nDebug mode overhead (vs the last %s run, %s):\n", debug ? "release" : "debug", path);
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j < other_n; j++) {
+            if (strcmp(labels[i], other_labels[j]) != 0) continue;
+            double release = debug ? other[j] : seconds[i];
+            double dbg = debug ? seconds[i] : other[j];
+            if (release > 0.0) {
+                printf("  %-28s release %f s, debug %f s, %+.1f%%\n",
+                       labels[i], release, dbg, 100.0 * (dbg - release) / release);
+            }
+            break;
+        }
+    }
+}
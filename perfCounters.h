@@ -0,0 +1,48 @@
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+#include <stdint.h>
+
+// hardware counters we sample around each benchmark run
+enum perf_counter_id {
+    PERF_CYCLES,
+    PERF_INSTRUCTIONS,
+    PERF_CACHE_REFERENCES,
+    PERF_CACHE_MISSES,
+    PERF_DTLB_MISSES,
+    PERF_NUM_COUNTERS
+};
+
+struct perf_counters {
+    int fds[PERF_NUM_COUNTERS];     // -1 when the counter couldn't be opened
+    int available;                  // at least one counter works
+    uint64_t values[PERF_NUM_COUNTERS];
+};
+
+// running totals so the benchmarks can print averages at the end
+struct perf_totals {
+    uint64_t values[PERF_NUM_COUNTERS];
+    int valid[PERF_NUM_COUNTERS];
+    int runs;
+};
+
+// opens every counter it can for the calling thread, never fails hard.
+// if perf_event_open is blocked (container, perf_event_paranoid, no PMU)
+// available stays 0 and start/stop become no-ops
+void perf_counters_open(struct perf_counters* pc);
+void perf_counters_start(struct perf_counters* pc);
+void perf_counters_stop(struct perf_counters* pc);
+void perf_counters_close(struct perf_counters* pc);
+
+void perf_totals_add(struct perf_totals* totals, const struct perf_counters* pc);
+void perf_totals_print(const char* label, const struct perf_totals* totals);
+
+// debug mode is a compile time switch, so one binary can only time one side.
+// this saves the per section averages to <bench>.<release|debug>.times and,
+// once the other build of the same benchmark has left its file behind,
+// prints what ALLOC_DEBUG costs per section. debug is the caller's
+// ALLOC_DEBUG_BUILD
+void perf_mode_compare(const char* bench, int debug, const char* const* labels,
+                       const double* seconds, int n);
+
+#endif /* PERF_COUNTERS_H */
@@ -1,65 +1,260 @@
 #include  <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
+#include <string.h>
 #include "poolAllocator.h"
+#include "allocDebug.h"
+#include "trace.h"
 
+static size_t chunk_bytes(struct memory_pool* pool, struct pool_chunk* chunk){
+    return chunk->num_blocks * pool->block_size;
+}
 
-struct memory_pool* pool_create(size_t block_size, size_t num_blocks){
-    if(block_size<sizeof(struct block_header)) block_size = sizeof(struct block_header);
+// which chunk ptr lives in, NULL if none. a single chunk pool is one range
+// check like before, otherwise a binary search over at most POOL_MAX_CHUNKS
+static struct pool_chunk* find_chunk(struct memory_pool* pool, void* ptr){
+    char* p = ptr;
+    if(pool->num_chunks == 1){
+        struct pool_chunk* chunk = &pool->chunks[0];
+        return (p >= chunk->memory && p < chunk->memory + chunk_bytes(pool, chunk)) ? chunk : NULL;
+    }
 
+    size_t lo = 0, hi = pool->num_chunks;
+    while(hi - lo > 1){
+        size_t mid = (lo + hi) / 2;
+        if(pool->chunks[pool->by_address[mid]].memory <= p) lo = mid;
+        else hi = mid;
+    }
 
-    struct memory_pool* mem_pool = malloc(sizeof(struct memory_pool));
-    if(!mem_pool) return NULL;
+    struct pool_chunk* chunk = &pool->chunks[pool->by_address[lo]];
+    if(p < chunk->memory || p >= chunk->memory + chunk_bytes(pool, chunk)) return NULL;
+    return chunk;
+}
 
+#ifdef ALLOC_DEBUG
+// debug layout of a block: [guard][payload][guard ...padding]
+// the free list link lives in the front guard while the block is free
+#define POOL_PAYLOAD_SIZE(pool) ((pool)->payload_size)
 
+static size_t debug_block_index(struct memory_pool* pool, struct pool_chunk* chunk, void* block){
+    return (size_t)((char*)block - chunk->memory) / pool->block_size;
+}
 
-    size_t total_size = block_size * num_blocks;
-    mem_pool->memory = malloc(total_size);
-    if(!mem_pool->memory){
-        free(mem_pool);
-        return NULL;
+static int debug_is_block(struct memory_pool* pool, struct pool_chunk* chunk, void* block){
+    return chunk && (size_t)((char*)block - chunk->memory) % pool->block_size == 0;
+}
+
+// freed blocks are filled with the poison pattern and hidden from ASan,
+// only the link in the front guard stays addressable
+static void debug_poison_block(struct memory_pool* pool, void* block){
+    ALLOC_ASAN_UNPOISON(block, pool->block_size);
+    memset(block, ALLOC_POISON_FREED, pool->block_size);
+    ALLOC_ASAN_POISON((char*)block + sizeof(struct block_header),
+                      pool->block_size - sizeof(struct block_header));
+}
+
+// only the shadow is poisoned here, blocks get the poison pattern when carved
+// so debug builds still don't fault in memory nobody uses
+static void debug_poison_chunk(struct memory_pool* pool, struct pool_chunk* chunk){
+    memset(chunk->allocated, 0, (chunk->num_blocks + 7) / 8);
+    ALLOC_ASAN_POISON(chunk->memory, chunk_bytes(pool, chunk));
+}
 
+// runs before we follow block->next so a trashed list aborts instead of crashing
+static void debug_check_free_block(struct memory_pool* pool, struct block_header* block){
+    struct pool_chunk* chunk = find_chunk(pool, block);
+    if(!debug_is_block(pool, chunk, block)) alloc_debug_fail("pool_alloc", "free list corrupted", block);
+    if(block->next && !debug_is_block(pool, find_chunk(pool, block->next), block->next)){
+        alloc_debug_fail("pool_alloc", "free list link corrupted", block->next);
+    }
+    if(alloc_bitmap_test(chunk->allocated, debug_block_index(pool, chunk, block))){
+        alloc_debug_fail("pool_alloc", "free list handed out a live block", block);
     }
+}
 
-    mem_pool->block_size = block_size;
-    mem_pool->total_blocks = num_blocks;
-    mem_pool->free_blocks = num_blocks;
+static void* debug_on_alloc(struct memory_pool* pool, struct block_header* block){
+    struct pool_chunk* chunk = find_chunk(pool, block);
+    size_t idx = debug_block_index(pool, chunk, block);
+    ALLOC_ASAN_UNPOISON(block, pool->block_size);
+    char* payload = (char*)block + ALLOC_GUARD_SIZE;
+    if(!alloc_check_poison(payload, pool->payload_size)){
+        alloc_debug_fail("pool_alloc", "block was written after free", payload);
+    }
+
+    alloc_bitmap_set(chunk->allocated, idx);
+    alloc_write_canary(block);
+    alloc_write_canary(payload + pool->payload_size);
+    memset(payload, ALLOC_POISON_FRESH, pool->payload_size);
+    return payload;
+}
+
+static struct block_header* debug_on_free(struct memory_pool* pool, void* ptr){
+    char* block = (char*)ptr - ALLOC_GUARD_SIZE;
+    struct pool_chunk* chunk = find_chunk(pool, block);
+    if(!chunk) alloc_debug_fail("pool_free", "pointer not from this pool", ptr);
+    if(!debug_is_block(pool, chunk, block)) alloc_debug_fail("pool_free", "misaligned pointer", ptr);
+
+    size_t idx = debug_block_index(pool, chunk, block);
+    if(!alloc_bitmap_test(chunk->allocated, idx)) alloc_debug_fail("pool_free", "double free", ptr);
+
+    if(!alloc_check_canary(block)) alloc_debug_fail("pool_free", "buffer underflow", ptr);
+    if(!alloc_check_canary((char*)ptr + pool->payload_size)){
+        alloc_debug_fail("pool_free", "buffer overflow", ptr);
+    }
+
+    alloc_bitmap_clear(chunk->allocated, idx);
+    debug_poison_block(pool, block);
+    return (struct block_header*)block;
+}
+#else
+#define POOL_PAYLOAD_SIZE(pool) ((pool)->block_size)
+#endif
+
+static int pool_add_chunk(struct memory_pool* pool, size_t num_blocks){
+    if(pool->num_chunks == POOL_MAX_CHUNKS || num_blocks == 0) return 0;
+
+    struct pool_chunk* chunk = &pool->chunks[pool->num_chunks];
+    chunk->memory = malloc(pool->block_size * num_blocks);
+    if(!chunk->memory) return 0;
+    chunk->num_blocks = num_blocks;
+
+#ifdef ALLOC_DEBUG
+    chunk->allocated = alloc_bitmap_create(num_blocks);
+    if(!chunk->allocated){
+        free(chunk->memory);
+        return 0;
+    }
+    debug_poison_chunk(pool, chunk);
+#endif
+
+    // keep by_address sorted, it's tiny so insertion sort is fine
+    size_t i = pool->num_chunks;
+    while(i > 0 && pool->chunks[pool->by_address[i - 1]].memory > chunk->memory){
+        pool->by_address[i] = pool->by_address[i - 1];
+        i--;
+    }
+    pool->by_address[i] = (uint8_t)pool->num_chunks;
+
+    pool->num_chunks++;
+    pool->total_blocks += num_blocks;
+    pool->free_blocks += num_blocks;
+    STATS_SLAB_CREATED(&pool->stats);
+    return 1;
+}
 
+// called when every block is handed out. the new chunk becomes the carve tail
+static int pool_grow(struct memory_pool* pool){
+    if(pool->growth_factor < 1.0) return 0;
+    if(pool->max_blocks && pool->total_blocks >= pool->max_blocks) return 0;
 
-    mem_pool->free_list = mem_pool->memory;
-    struct block_header* curr = mem_pool->free_list;
+    size_t last = pool->chunks[pool->num_chunks - 1].num_blocks;
+    size_t num_blocks = (size_t)(last * pool->growth_factor);
+    if(num_blocks == 0) num_blocks = 1;
+    if(pool->max_blocks && pool->total_blocks + num_blocks > pool->max_blocks){
+        num_blocks = pool->max_blocks - pool->total_blocks;
+    }
 
+    if(!pool_add_chunk(pool, num_blocks)) return 0;
+    pool->carve_chunk = pool->num_chunks - 1;
+    pool->carved_blocks = 0;
+    return 1;
+}
 
-    for(size_t i=0;i<num_blocks-1;i++){
+struct memory_pool* pool_create_growable(size_t block_size, size_t initial_blocks,
+                                         double growth_factor, size_t max_blocks){
+    if(block_size<sizeof(struct block_header)) block_size = sizeof(struct block_header);
+#ifdef ALLOC_DEBUG
+    size_t payload_size = block_size;
+    block_size = (payload_size + 2 * ALLOC_GUARD_SIZE + 15) & ~(size_t)15;
+#endif
 
-        struct block_header* next = (struct block_header*)((char*)curr + block_size);
-        curr->next = next;
-        curr = next;
 
+    struct memory_pool* mem_pool = malloc(sizeof(struct memory_pool));
+    if(!mem_pool) return NULL;
 
+    mem_pool->block_size = block_size;
+    mem_pool->total_blocks = 0;
+    mem_pool->free_blocks = 0;
+    mem_pool->num_chunks = 0;
+    mem_pool->growth_factor = growth_factor;
+    mem_pool->max_blocks = max_blocks;
+    memset(&mem_pool->stats, 0, sizeof(mem_pool->stats));
+#ifdef ALLOC_DEBUG
+    mem_pool->payload_size = payload_size;
+#endif
+
+    if(!pool_add_chunk(mem_pool, initial_blocks)){
+        free(mem_pool);
+        return NULL;
     }
-    curr->next = NULL;
+
+    // blocks are carved off lazily in pool_alloc, so nothing in the region
+    // gets touched (or faulted in) until it's actually used
+    mem_pool->free_list = NULL;
+    mem_pool->carve_chunk = 0;
+    mem_pool->carved_blocks = 0;
     return mem_pool;
 }
 
+struct memory_pool* pool_create(size_t block_size, size_t num_blocks){
+    return pool_create_growable(block_size, num_blocks, 0.0, num_blocks);
+}
+
 void* pool_alloc(struct memory_pool* pool){
-    if(!pool||!(pool->free_blocks)) return NULL;
+    if(!pool) return NULL;
+    return pool_alloc_sized(pool, POOL_PAYLOAD_SIZE(pool));
+}
 
-    struct block_header* block = pool->free_list;
+static void* pool_alloc_block(struct memory_pool* pool, size_t size){
+    if(size > POOL_PAYLOAD_SIZE(pool) || (!(pool->free_blocks) && !pool_grow(pool))){
+        STATS_FAIL(&pool->stats);
+        return NULL;
+    }
 
-    pool->free_list = block->next;
+    struct block_header* block = pool->free_list;
+    if(block){
+#ifdef ALLOC_DEBUG
+        debug_check_free_block(pool, block);
+#endif
+        pool->free_list = block->next;
+    }else{
+        // nothing recycled, take the next never-used block off the tail
+        struct pool_chunk* chunk = &pool->chunks[pool->carve_chunk];
+        if(pool->carved_blocks == chunk->num_blocks){
+            chunk = &pool->chunks[++pool->carve_chunk];
+            pool->carved_blocks = 0;
+        }
+        block = (struct block_header*)(chunk->memory + pool->carved_blocks * pool->block_size);
+        pool->carved_blocks++;
+#ifdef ALLOC_DEBUG
+        debug_poison_block(pool, block);
+#endif
+    }
 
     pool->free_blocks--;
+    STATS_ALLOC(&pool->stats, size, pool->block_size);
 
+#ifdef ALLOC_DEBUG
+    return debug_on_alloc(pool, block);
+#endif
     return block;
 }
 
-void pool_free(struct memory_pool* pool, void* ptr){
-    if(!pool||!ptr) return;
+void* pool_alloc_sized(struct memory_pool* pool, size_t size){
+    if(!pool) return NULL;
+    TRACE_BEGIN("pool_alloc");
+    void* ptr = pool_alloc_block(pool, size);
+    TRACE_END("pool_alloc");
+    return ptr;
+}
 
+static void pool_free_block(struct memory_pool* pool, void* ptr){
 
+#ifdef ALLOC_DEBUG
+    ptr = debug_on_free(pool, ptr);
+#endif
 
-    if(ptr<pool->memory || ptr>= (void*)(char*)pool->memory + (pool->total_blocks * pool->block_size)) return;
+    if(!find_chunk(pool, ptr)) return;
 
 
 
@@ -68,39 +263,52 @@ void pool_free(struct memory_pool* pool, void* ptr){
 
     block->next = pool->free_list;
 
-    pool->free_list = block; 
+    pool->free_list = block;
 
 
     pool->free_blocks++;
+    STATS_FREE(&pool->stats, pool->block_size);
+}
+
+void pool_free(struct memory_pool* pool, void* ptr){
+    if(!pool||!ptr) return;
+    TRACE_BEGIN("pool_free");
+    pool_free_block(pool, ptr);
+    TRACE_END("pool_free");
 }
 
 void pool_reset(struct memory_pool* pool) {
     if (!pool) return;
-    
-    pool->free_list = pool->memory;
-    struct block_header* curr = pool->free_list;
-
-    // size_t block_count = pool->total_blocks * pool->block_size;
-    
-    for (size_t i = 0; i < pool->total_blocks - 1; i++) {
-        struct block_header* next = (struct block_header*)((char*)curr + pool->block_size);
-        curr->next = next;
-        curr = next;
-    }
-    curr->next = NULL;
-    
+
+#ifdef ALLOC_DEBUG
+    for (size_t i = 0; i < pool->num_chunks; i++) debug_poison_chunk(pool, &pool->chunks[i]);
+#endif
+
+    // O(1), everything goes back to being uncarved tail
+    pool->free_list = NULL;
+    pool->carve_chunk = 0;
+    pool->carved_blocks = 0;
     pool->free_blocks = pool->total_blocks;
+    STATS_RESET_IN_USE(&pool->stats);
 }
 
 void pool_destroy(struct memory_pool* pool){
-    if(!pool) return; 
-
-    if(pool->memory){
-        free(pool->memory);
-        pool->memory = NULL;
-
-
+    if(!pool) return;
+
+    for(size_t i=0;i<pool->num_chunks;i++){
+        struct pool_chunk* chunk = &pool->chunks[i];
+#ifdef ALLOC_DEBUG
+        ALLOC_ASAN_UNPOISON(chunk->memory, chunk_bytes(pool, chunk));
+        free(chunk->allocated);
+#endif
+        free(chunk->memory);
+        chunk->memory = NULL;
     }
 
     free(pool);
-}
\ No newline at end of file
+}
+
+void pool_get_stats(const struct memory_pool* pool, struct alloc_stats* out){
+    if(!pool||!out) return;
+    *out = pool->stats;
+}
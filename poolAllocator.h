@@ -2,23 +2,63 @@
 #define POOL_ALLOCATOR_H
 
 #include <stddef.h>
+#include <stdint.h>
+#include "allocStats.h"
+
+// hard cap on chunks per pool, with geometric growth this is plenty.
+// pool_free finds the owning chunk with a binary search over by_address,
+// so the lookup is O(log num_chunks), not O(1): one range check for a
+// single chunk pool and at most 5 steps with the cap at 32. the cap is
+// what keeps it constant bounded, if it ever goes up this should become
+// a page -> chunk table instead
+#define POOL_MAX_CHUNKS 32
 
 struct block_header {
     struct block_header* next;
 };
 
+struct pool_chunk {
+    char* memory;
+    size_t num_blocks;
+#ifdef ALLOC_DEBUG
+    uint8_t* allocated;         // one bit per block, catches double frees
+#endif
+};
+
 struct memory_pool {
-    void* memory;
     size_t block_size;
-    size_t total_blocks;
+    size_t total_blocks;        // across every chunk
     size_t free_blocks;
-    struct block_header* free_list;
+    struct block_header* free_list;   // only blocks that have been freed at least once
+    size_t carve_chunk;         // chunk the never-used tail starts in
+    size_t carved_blocks;       // blocks [0, carved_blocks) of carve_chunk have been handed out
+
+    struct pool_chunk chunks[POOL_MAX_CHUNKS];  // in creation order
+    uint8_t by_address[POOL_MAX_CHUNKS];        // chunk indices sorted by memory, for pool_free
+    size_t num_chunks;
+
+    double growth_factor;       // next chunk = last chunk * growth_factor, 0 = fixed size
+    size_t max_blocks;          // total_blocks never grows past this
+    struct alloc_stats stats;
+#ifdef ALLOC_DEBUG
+    size_t payload_size;        // what the caller asked for, block_size adds the guards
+#endif
 };
 
 struct memory_pool* pool_create(size_t block_size, size_t num_blocks);
+// pool that adds a chunk instead of failing when it runs dry.
+// growth_factor >= 1.0 sizes each new chunk relative to the previous one,
+// max_blocks caps the total (0 means only POOL_MAX_CHUNKS limits it)
+struct memory_pool* pool_create_growable(size_t block_size, size_t initial_blocks,
+                                         double growth_factor, size_t max_blocks);
 void* pool_alloc(struct memory_pool* pool);
+// same as pool_alloc but records how much of the block the caller needs,
+// so the stats can report internal fragmentation. fails if size > block_size
+void* pool_alloc_sized(struct memory_pool* pool, size_t size);
 void pool_free(struct memory_pool* pool, void* ptr);
+// keeps every chunk, just makes all of them free again
 void pool_reset(struct memory_pool* pool);
 void pool_destroy(struct memory_pool* pool);
+void pool_get_stats(const struct memory_pool* pool, struct alloc_stats* out);
 
-#endif /* POOL_ALLOCATOR_H */
\ No newline at end of file
+#endif /* POOL_ALLOCATOR_H */
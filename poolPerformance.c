@@ -5,41 +5,113 @@
 #include <math.h>
 #include <unistd.h>
 #include "poolAllocator.h"
+#include "bitmapPool.h"
+#include "poolSet.h"
+#include "inputPipeline.h"
+#include "mlpGraph.h"
+#include "perfCounters.h"
+#include "allocDebug.h"
+#include "kernels.h"
+#include "threadArena.h"
+#include "trace.h"
+#include "weightFile.h"
 
 #define BATCH_SIZE 32
 #define INPUT_DIM 784
 #define HIDDEN_DIM 128
 #define OUTPUT_DIM 10
 
-typedef struct {
-    void* data;
-    int rows;
-    int cols;
-} Tensor;
-
-float W1_data[INPUT_DIM * HIDDEN_DIM];
-float b1_data[HIDDEN_DIM];
-float W2_data[HIDDEN_DIM * OUTPUT_DIM];
-float b2_data[OUTPUT_DIM];
+const float* W1_data;
+const float* b1_data;
+const float* W2_data;
+const float* b2_data;
 Tensor W1;
 Tensor W2;
 
+struct weight_file* weights = NULL;
+
+void load_weights(const char* path) {
+    const struct weight_spec specs[] = {
+        {"W1", INPUT_DIM, HIDDEN_DIM, &W1_data},
+        {"b1", 1, HIDDEN_DIM, &b1_data},
+        {"W2", HIDDEN_DIM, OUTPUT_DIM, &W2_data},
+        {"b2", 1, OUTPUT_DIM, &b2_data},
+    };
+    weights = weight_file_load_or_create(path, specs, sizeof(specs) / sizeof(specs[0]));
+    if (!weights) {
+        printf("Failed to load weights from %s!\n", path);
+        exit(1);
+    }
+}
+
 struct memory_pool* tensor_pool = NULL;
+struct bitmap_pool* bitmap_tensor_pool = NULL;
+struct pool_set* tensor_pool_set = NULL;
+struct input_pipeline* input_pipe = NULL;
+struct mlp_plan* forward_plan = NULL;
+unsigned int loader_seed;
+
+#define PIPELINE_DEPTH 4
+
+// runs on the loader thread, so no rand() and its hidden lock
+void fill_random_batch(float* data, int rows, int cols, void* ctx) {
+    unsigned int* seed = ctx;
+    for (int i = 0; i < rows * cols; i++) {
+        data[i] = -5.0f + ((float)rand_r(seed) / (float)RAND_MAX) * 10.0f;
+    }
+}
 
 void init_pool_system() {
     size_t max_size = sizeof(float) * BATCH_SIZE * 
                      (INPUT_DIM > HIDDEN_DIM ? INPUT_DIM : HIDDEN_DIM);
 
-    tensor_pool = pool_create(max_size, 10);
+    // starts smaller than one forward pass needs on purpose, the pool
+    // grows a chunk on the first run and reuses it after every reset
+    tensor_pool = pool_create_growable(max_size, 4, 2.0, 64);
     if (!tensor_pool) {
         printf("Failed to create memory pool!\n");
         exit(1);
     }
+
+    bitmap_tensor_pool = bitmap_pool_create(max_size, 10);
+    if (!bitmap_tensor_pool) {
+        printf("Failed to create bitmap pool!\n");
+        exit(1);
+    }
+
+    // what one forward pass keeps live at its peak
+    struct pool_class_profile profile[] = {
+        {sizeof(float) * BATCH_SIZE * INPUT_DIM, 1},
+        {sizeof(float) * BATCH_SIZE * HIDDEN_DIM, 4},
+        {sizeof(float) * BATCH_SIZE * OUTPUT_DIM, 1},
+    };
+    tensor_pool_set = pool_set_create(profile, sizeof(profile) / sizeof(profile[0]), 2.0);
+    if (!tensor_pool_set) {
+        printf("Failed to create pool set!\n");
+        exit(1);
+    }
+
+    loader_seed = rand();
+    input_pipe = input_pipeline_create(BATCH_SIZE, INPUT_DIM, PIPELINE_DEPTH,
+                                       fill_random_batch, &loader_seed);
+    if (!input_pipe) {
+        printf("Failed to start input pipeline!\n");
+        exit(1);
+    }
+}
+
+void* std_malloc(size_t size) {
+    TRACE_BEGIN("malloc");
+    void* ptr = malloc(size);
+    TRACE_END("malloc");
+    return ptr;
 }
 
 void free_tensor(Tensor* t) {
     if (t && t->data) {
+        TRACE_BEGIN("free");
         free(t->data);
+        TRACE_END("free");
         t->data = NULL;
     }
 }
@@ -51,47 +123,67 @@ void free_pool_tensor(Tensor* t) {
     }
 }
 
-void matmul(const Tensor* A, const Tensor* B, Tensor* out) {
-    float* a = (float*)A->data;
-    float* b = (float*)B->data;
-    float* c = (float*)out->data;
-    
-    for (int i = 0; i < A->rows; i++) {
-        for (int j = 0; j < B->cols; j++) {
-            c[i * out->cols + j] = 0;
-            for (int k = 0; k < A->cols; k++) {
-                c[i * out->cols + j] += a[i * A->cols + k] * b[k * B->cols + j];
-            }
-        }
+// one kernel per layer shape the forward pass actually runs
+MATMUL_KERNEL(BATCH_SIZE, INPUT_DIM, HIDDEN_DIM)
+MATMUL_KERNEL(BATCH_SIZE, HIDDEN_DIM, HIDDEN_DIM)
+MATMUL_KERNEL(BATCH_SIZE, HIDDEN_DIM, OUTPUT_DIM)
+
+const struct matmul_kernel matmul_kernels[] = {
+    MATMUL_KERNEL_ENTRY(BATCH_SIZE, INPUT_DIM, HIDDEN_DIM),
+    MATMUL_KERNEL_ENTRY(BATCH_SIZE, HIDDEN_DIM, HIDDEN_DIM),
+    MATMUL_KERNEL_ENTRY(BATCH_SIZE, HIDDEN_DIM, OUTPUT_DIM),
+};
+#define NUM_MATMUL_KERNELS (int)(sizeof(matmul_kernels) / sizeof(matmul_kernels[0]))
+
+struct scratch_arena weight_arena;     // packed weights, lives as long as the program
+
+// done once at startup, every forward pass after this streams the panels
+void pack_weights() {
+    // the hidden layers run the first HIDDEN_DIM rows of W1, that fits as is
+    int w1_rows = INPUT_DIM > HIDDEN_DIM ? INPUT_DIM : HIDDEN_DIM;
+    size_t bytes = matmul_packed_size(w1_rows, HIDDEN_DIM) + matmul_packed_size(HIDDEN_DIM, OUTPUT_DIM);
+    if (!scratch_arena_init(&weight_arena, bytes + 64)) {
+        printf("Failed to create weight arena!\n");
+        exit(1);
     }
+    pack_weight(&weight_arena, &W1, w1_rows);
+    pack_weight(&weight_arena, &W2, HIDDEN_DIM);
+}
+
+void matmul(const Tensor* A, const Tensor* B, Tensor* out) {
+    kernels_matmul(matmul_kernels, NUM_MATMUL_KERNELS, A, B, out);
 }
 
 void add_bias(Tensor* out, const float* bias) {
     float* data = (float*)out->data;
+    TRACE_BEGIN("add_bias");
     for (int i = 0; i < out->rows; i++) {
         for (int j = 0; j < out->cols; j++) {
             data[i * out->cols + j] += bias[j];
         }
     }
+    TRACE_END("add_bias");
 }
 
 void relu(Tensor* t) {
     float* data = (float*)t->data;
     int size = t->rows * t->cols;
+    TRACE_BEGIN("relu");
     for (int i = 0; i < size; i++) {
         if (data[i] < 0) {
             data[i] = 0;
         }
     }
+    TRACE_END("relu");
 }
 
 void run_standard_allocator() {
-    Tensor input = {malloc(sizeof(float)*BATCH_SIZE*INPUT_DIM), BATCH_SIZE, INPUT_DIM};
-    Tensor h1 = {malloc(sizeof(float)*BATCH_SIZE*HIDDEN_DIM), BATCH_SIZE, HIDDEN_DIM};
-    Tensor h2 = {malloc(sizeof(float)*BATCH_SIZE*HIDDEN_DIM), BATCH_SIZE, HIDDEN_DIM};
-    Tensor h3 = {malloc(sizeof(float)*BATCH_SIZE*HIDDEN_DIM), BATCH_SIZE, HIDDEN_DIM};
-    Tensor h4 = {malloc(sizeof(float)*BATCH_SIZE*HIDDEN_DIM), BATCH_SIZE, HIDDEN_DIM};
-    Tensor output = {malloc(sizeof(float)*BATCH_SIZE*OUTPUT_DIM), BATCH_SIZE, OUTPUT_DIM};
+    Tensor input = {std_malloc(sizeof(float)*BATCH_SIZE*INPUT_DIM), BATCH_SIZE, INPUT_DIM, LAYOUT_ROW_MAJOR};
+    Tensor h1 = {std_malloc(sizeof(float)*BATCH_SIZE*HIDDEN_DIM), BATCH_SIZE, HIDDEN_DIM, LAYOUT_ROW_MAJOR};
+    Tensor h2 = {std_malloc(sizeof(float)*BATCH_SIZE*HIDDEN_DIM), BATCH_SIZE, HIDDEN_DIM, LAYOUT_ROW_MAJOR};
+    Tensor h3 = {std_malloc(sizeof(float)*BATCH_SIZE*HIDDEN_DIM), BATCH_SIZE, HIDDEN_DIM, LAYOUT_ROW_MAJOR};
+    Tensor h4 = {std_malloc(sizeof(float)*BATCH_SIZE*HIDDEN_DIM), BATCH_SIZE, HIDDEN_DIM, LAYOUT_ROW_MAJOR};
+    Tensor output = {std_malloc(sizeof(float)*BATCH_SIZE*OUTPUT_DIM), BATCH_SIZE, OUTPUT_DIM, LAYOUT_ROW_MAJOR};
     
     for (int i = 0; i < BATCH_SIZE*INPUT_DIM; i++) {
         ((float*)input.data)[i] = -5.0f + ((float)rand() / (float)RAND_MAX) * 10.0f;
@@ -125,12 +217,12 @@ void run_standard_allocator() {
 }
 
 void run_pool_allocator() {
-    Tensor input = {pool_alloc(tensor_pool), BATCH_SIZE, INPUT_DIM};
-    Tensor h1 = {pool_alloc(tensor_pool), BATCH_SIZE, HIDDEN_DIM};
-    Tensor h2 = {pool_alloc(tensor_pool), BATCH_SIZE, HIDDEN_DIM};
-    Tensor h3 = {pool_alloc(tensor_pool), BATCH_SIZE, HIDDEN_DIM};
-    Tensor h4 = {pool_alloc(tensor_pool), BATCH_SIZE, HIDDEN_DIM};
-    Tensor output = {pool_alloc(tensor_pool), BATCH_SIZE, OUTPUT_DIM};
+    Tensor input = {pool_alloc_sized(tensor_pool, sizeof(float)*BATCH_SIZE*INPUT_DIM), BATCH_SIZE, INPUT_DIM, LAYOUT_ROW_MAJOR};
+    Tensor h1 = {pool_alloc_sized(tensor_pool, sizeof(float)*BATCH_SIZE*HIDDEN_DIM), BATCH_SIZE, HIDDEN_DIM, LAYOUT_ROW_MAJOR};
+    Tensor h2 = {pool_alloc_sized(tensor_pool, sizeof(float)*BATCH_SIZE*HIDDEN_DIM), BATCH_SIZE, HIDDEN_DIM, LAYOUT_ROW_MAJOR};
+    Tensor h3 = {pool_alloc_sized(tensor_pool, sizeof(float)*BATCH_SIZE*HIDDEN_DIM), BATCH_SIZE, HIDDEN_DIM, LAYOUT_ROW_MAJOR};
+    Tensor h4 = {pool_alloc_sized(tensor_pool, sizeof(float)*BATCH_SIZE*HIDDEN_DIM), BATCH_SIZE, HIDDEN_DIM, LAYOUT_ROW_MAJOR};
+    Tensor output = {pool_alloc_sized(tensor_pool, sizeof(float)*BATCH_SIZE*OUTPUT_DIM), BATCH_SIZE, OUTPUT_DIM, LAYOUT_ROW_MAJOR};
     
     for (int i = 0; i < BATCH_SIZE*INPUT_DIM; i++) {
         ((float*)input.data)[i] = -5.0f + ((float)rand() / (float)RAND_MAX) * 10.0f;
@@ -163,6 +255,171 @@ void run_pool_allocator() {
     free_pool_tensor(&output);
 }
 
+void run_bitmap_pool_allocator() {
+    // all six tensors come out of one bulk call, lowest addresses first
+    void* blocks[6];
+    const size_t sizes[6] = {
+        sizeof(float)*BATCH_SIZE*INPUT_DIM, sizeof(float)*BATCH_SIZE*HIDDEN_DIM,
+        sizeof(float)*BATCH_SIZE*HIDDEN_DIM, sizeof(float)*BATCH_SIZE*HIDDEN_DIM,
+        sizeof(float)*BATCH_SIZE*HIDDEN_DIM, sizeof(float)*BATCH_SIZE*OUTPUT_DIM,
+    };
+    if (!bitmap_pool_alloc_bulk_sized(bitmap_tensor_pool, blocks, sizes, 6)) {
+        printf("Bitmap pool exhausted!\n");
+        exit(1);
+    }
+
+    Tensor input = {blocks[0], BATCH_SIZE, INPUT_DIM, LAYOUT_ROW_MAJOR};
+    Tensor h1 = {blocks[1], BATCH_SIZE, HIDDEN_DIM, LAYOUT_ROW_MAJOR};
+    Tensor h2 = {blocks[2], BATCH_SIZE, HIDDEN_DIM, LAYOUT_ROW_MAJOR};
+    Tensor h3 = {blocks[3], BATCH_SIZE, HIDDEN_DIM, LAYOUT_ROW_MAJOR};
+    Tensor h4 = {blocks[4], BATCH_SIZE, HIDDEN_DIM, LAYOUT_ROW_MAJOR};
+    Tensor output = {blocks[5], BATCH_SIZE, OUTPUT_DIM, LAYOUT_ROW_MAJOR};
+    
+    for (int i = 0; i < BATCH_SIZE*INPUT_DIM; i++) {
+        ((float*)input.data)[i] = -5.0f + ((float)rand() / (float)RAND_MAX) * 10.0f;
+    }
+    
+    matmul(&input, &W1, &h1);
+    add_bias(&h1, b1_data);
+    relu(&h1);
+    
+    matmul(&h1, &W1, &h2);
+    add_bias(&h2, b1_data);
+    relu(&h2);
+    
+    matmul(&h2, &W1, &h3);
+    add_bias(&h3, b1_data);
+    relu(&h3);
+    
+    matmul(&h3, &W1, &h4);
+    add_bias(&h4, b1_data);
+    relu(&h4);
+    
+    matmul(&h4, &W2, &output);
+    add_bias(&output, b2_data);
+    
+    for (int i = 0; i < 6; i++) {
+        bitmap_pool_free(bitmap_tensor_pool, blocks[i]);
+    }
+}
+
+void run_pool_set_allocator() {
+    Tensor input = {pool_set_alloc(tensor_pool_set, sizeof(float)*BATCH_SIZE*INPUT_DIM), BATCH_SIZE, INPUT_DIM, LAYOUT_ROW_MAJOR};
+    Tensor h1 = {pool_set_alloc(tensor_pool_set, sizeof(float)*BATCH_SIZE*HIDDEN_DIM), BATCH_SIZE, HIDDEN_DIM, LAYOUT_ROW_MAJOR};
+    Tensor h2 = {pool_set_alloc(tensor_pool_set, sizeof(float)*BATCH_SIZE*HIDDEN_DIM), BATCH_SIZE, HIDDEN_DIM, LAYOUT_ROW_MAJOR};
+    Tensor h3 = {pool_set_alloc(tensor_pool_set, sizeof(float)*BATCH_SIZE*HIDDEN_DIM), BATCH_SIZE, HIDDEN_DIM, LAYOUT_ROW_MAJOR};
+    Tensor h4 = {pool_set_alloc(tensor_pool_set, sizeof(float)*BATCH_SIZE*HIDDEN_DIM), BATCH_SIZE, HIDDEN_DIM, LAYOUT_ROW_MAJOR};
+    Tensor output = {pool_set_alloc(tensor_pool_set, sizeof(float)*BATCH_SIZE*OUTPUT_DIM), BATCH_SIZE, OUTPUT_DIM, LAYOUT_ROW_MAJOR};
+    
+    for (int i = 0; i < BATCH_SIZE*INPUT_DIM; i++) {
+        ((float*)input.data)[i] = -5.0f + ((float)rand() / (float)RAND_MAX) * 10.0f;
+    }
+    
+    matmul(&input, &W1, &h1);
+    add_bias(&h1, b1_data);
+    relu(&h1);
+    
+    matmul(&h1, &W1, &h2);
+    add_bias(&h2, b1_data);
+    relu(&h2);
+    
+    matmul(&h2, &W1, &h3);
+    add_bias(&h3, b1_data);
+    relu(&h3);
+    
+    matmul(&h3, &W1, &h4);
+    add_bias(&h4, b1_data);
+    relu(&h4);
+    
+    matmul(&h4, &W2, &output);
+    add_bias(&output, b2_data);
+    
+    pool_set_free(tensor_pool_set, input.data, sizeof(float)*BATCH_SIZE*INPUT_DIM);
+    pool_set_free(tensor_pool_set, h1.data, sizeof(float)*BATCH_SIZE*HIDDEN_DIM);
+    pool_set_free(tensor_pool_set, h2.data, sizeof(float)*BATCH_SIZE*HIDDEN_DIM);
+    pool_set_free(tensor_pool_set, h3.data, sizeof(float)*BATCH_SIZE*HIDDEN_DIM);
+    pool_set_free(tensor_pool_set, h4.data, sizeof(float)*BATCH_SIZE*HIDDEN_DIM);
+    pool_set_free(tensor_pool_set, output.data, sizeof(float)*BATCH_SIZE*OUTPUT_DIM);
+}
+
+// pool allocator again, but the input batch was filled ahead of time by the
+// loader thread and goes back to it afterwards instead of being freed
+void run_pipeline_allocator() {
+    Tensor input = {input_pipeline_next(input_pipe), BATCH_SIZE, INPUT_DIM, LAYOUT_ROW_MAJOR};
+    Tensor h1 = {pool_alloc_sized(tensor_pool, sizeof(float)*BATCH_SIZE*HIDDEN_DIM), BATCH_SIZE, HIDDEN_DIM, LAYOUT_ROW_MAJOR};
+    Tensor h2 = {pool_alloc_sized(tensor_pool, sizeof(float)*BATCH_SIZE*HIDDEN_DIM), BATCH_SIZE, HIDDEN_DIM, LAYOUT_ROW_MAJOR};
+    Tensor h3 = {pool_alloc_sized(tensor_pool, sizeof(float)*BATCH_SIZE*HIDDEN_DIM), BATCH_SIZE, HIDDEN_DIM, LAYOUT_ROW_MAJOR};
+    Tensor h4 = {pool_alloc_sized(tensor_pool, sizeof(float)*BATCH_SIZE*HIDDEN_DIM), BATCH_SIZE, HIDDEN_DIM, LAYOUT_ROW_MAJOR};
+    Tensor output = {pool_alloc_sized(tensor_pool, sizeof(float)*BATCH_SIZE*OUTPUT_DIM), BATCH_SIZE, OUTPUT_DIM, LAYOUT_ROW_MAJOR};
+    
+    matmul(&input, &W1, &h1);
+    add_bias(&h1, b1_data);
+    relu(&h1);
+    
+    matmul(&h1, &W1, &h2);
+    add_bias(&h2, b1_data);
+    relu(&h2);
+    
+    matmul(&h2, &W1, &h3);
+    add_bias(&h3, b1_data);
+    relu(&h3);
+    
+    matmul(&h3, &W1, &h4);
+    add_bias(&h4, b1_data);
+    relu(&h4);
+    
+    matmul(&h4, &W2, &output);
+    add_bias(&output, b2_data);
+    
+    input_pipeline_release(input_pipe, input.data);
+    free_pool_tensor(&h1);
+    free_pool_tensor(&h2);
+    free_pool_tensor(&h3);
+    free_pool_tensor(&h4);
+    free_pool_tensor(&output);
+}
+
+static inline double wall_seconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// the same network as the unrolled run_* functions, as data. hidden
+// layers reuse W1 exactly like they do, the plan packs its own copy
+void init_plan() {
+    struct mlp_graph graph;
+    mlp_graph_init(&graph, INPUT_DIM);
+    mlp_graph_add_dense(&graph, "fc1", HIDDEN_DIM, W1_data, b1_data, 1);
+    mlp_graph_add_dense(&graph, "fc2", HIDDEN_DIM, W1_data, b1_data, 1);
+    mlp_graph_add_dense(&graph, "fc3", HIDDEN_DIM, W1_data, b1_data, 1);
+    mlp_graph_add_dense(&graph, "fc4", HIDDEN_DIM, W1_data, b1_data, 1);
+    mlp_graph_add_dense(&graph, "out", OUTPUT_DIM, W2_data, b2_data, 0);
+
+    // no MLP_PLAN_TIMING here, its clock reads would land in the plan's
+    // average. profile_plan turns it on afterwards for the breakdown
+    forward_plan = mlp_plan_compile(&graph, BATCH_SIZE, 0);
+    if (!forward_plan) {
+        printf("Failed to compile forward plan!\n");
+        exit(1);
+    }
+}
+
+// no allocator calls at all, every buffer was handed out at compile time
+void run_plan() {
+    for (int i = 0; i < BATCH_SIZE*INPUT_DIM; i++) {
+        forward_plan->input[i] = -5.0f + ((float)rand() / (float)RAND_MAX) * 10.0f;
+    }
+    mlp_plan_run(forward_plan);
+}
+
+// separate runs with per layer timing on, after the timed loop
+void profile_plan(int runs) {
+    forward_plan->flags |= MLP_PLAN_TIMING;
+    for (int r = 0; r < runs; r++) run_plan();
+    forward_plan->flags &= ~MLP_PLAN_TIMING;
+}
+
 void clear_cpu_cache() {
     int* cache_clear = (int*)malloc(32 * 1024 * 1024);
     if (cache_clear) {
@@ -173,58 +430,110 @@ void clear_cpu_cache() {
     }
 }
 
-int main() {
+int main(int argc, char* argv[]) {
     srand(time(NULL));
     
-    // Initialize weight matrices
-    for(int i = 0; i < INPUT_DIM * HIDDEN_DIM; i++) {
-        W1_data[i] = -0.5f + ((float)rand() / (float)RAND_MAX);
-    }
-    for(int i = 0; i < HIDDEN_DIM; i++) {
-        b1_data[i] = -0.5f + ((float)rand() / (float)RAND_MAX);
-    }
-    for(int i = 0; i < HIDDEN_DIM * OUTPUT_DIM; i++) {
-        W2_data[i] = -0.5f + ((float)rand() / (float)RAND_MAX);
-    }
-    for(int i = 0; i < OUTPUT_DIM; i++) {
-        b2_data[i] = -0.5f + ((float)rand() / (float)RAND_MAX);
-    }
+    const char* weights_path = argc > 1 ? argv[1] : "weights_784x128x10.bin";
+    struct timespec load_start, load_end;
+    clock_gettime(CLOCK_MONOTONIC, &load_start);
+    load_weights(weights_path);
+    clock_gettime(CLOCK_MONOTONIC, &load_end);
+    printf("Mapped %zu bytes of weights from %s in %f seconds\n", weights->size, weights_path,
+           (load_end.tv_sec - load_start.tv_sec) + (load_end.tv_nsec - load_start.tv_nsec) / 1e9);
     
-    W1.data = W1_data;
+    W1.data = (void*)W1_data;
     W1.rows = INPUT_DIM;
     W1.cols = HIDDEN_DIM;
     
-    W2.data = W2_data;
+    W2.data = (void*)W2_data;
     W2.rows = HIDDEN_DIM;
     W2.cols = OUTPUT_DIM;
+    pack_weights();
     
     init_pool_system();
+    init_plan();
     
-    printf("Running benchmarks...\n");
+    printf("Running benchmarks (%s build)...\n", ALLOC_DEBUG_MODE_STR);
     
     const int NUM_ITERATIONS = 100;
-    double std_total = 0.0, pool_total = 0.0;
+    double std_total = 0.0, pool_total = 0.0, bitmap_total = 0.0, set_total = 0.0, pipe_total = 0.0, plan_total = 0.0;
     clock_t start, end;
+
+    struct perf_counters pc;
+    struct perf_totals std_perf = {0}, pool_perf = {0}, bitmap_perf = {0}, set_perf = {0}, pipe_perf = {0}, plan_perf = {0};
+    perf_counters_open(&pc);
     
     for (int i = 0; i < NUM_ITERATIONS; i++) {
         clear_cpu_cache();
+        perf_counters_start(&pc);
         start = clock();
         run_standard_allocator();
         end = clock();
+        perf_counters_stop(&pc);
+        perf_totals_add(&std_perf, &pc);
         double std_time = ((double)(end - start)) / CLOCKS_PER_SEC;
         std_total += std_time;
         printf("Standard allocator took %f seconds\n", std_time);
         
         clear_cpu_cache();
+        perf_counters_start(&pc);
         start = clock();
         run_pool_allocator();
         end = clock();
+        perf_counters_stop(&pc);
+        perf_totals_add(&pool_perf, &pc);
         double pool_time = ((double)(end - start)) / CLOCKS_PER_SEC;
         pool_total += pool_time;
         printf("Pool allocator took %f seconds\n", pool_time);
         
+        clear_cpu_cache();
+        perf_counters_start(&pc);
+        start = clock();
+        run_bitmap_pool_allocator();
+        end = clock();
+        perf_counters_stop(&pc);
+        perf_totals_add(&bitmap_perf, &pc);
+        double bitmap_time = ((double)(end - start)) / CLOCKS_PER_SEC;
+        bitmap_total += bitmap_time;
+        printf("Bitmap pool allocator took %f seconds\n", bitmap_time);
+        
+        clear_cpu_cache();
+        perf_counters_start(&pc);
+        start = clock();
+        run_pool_set_allocator();
+        end = clock();
+        perf_counters_stop(&pc);
+        perf_totals_add(&set_perf, &pc);
+        double set_time = ((double)(end - start)) / CLOCKS_PER_SEC;
+        set_total += set_time;
+        printf("Pool set allocator took %f seconds\n", set_time);
+        
+        // wall clock here, clock() would also bill us for the loader's cpu time
+        clear_cpu_cache();
+        perf_counters_start(&pc);
+        double pipe_start = wall_seconds();
+        run_pipeline_allocator();
+        double pipe_time = wall_seconds() - pipe_start;
+        perf_counters_stop(&pc);
+        perf_totals_add(&pipe_perf, &pc);
+        pipe_total += pipe_time;
+        printf("Pipelined pool allocator took %f seconds\n", pipe_time);
+        
+        clear_cpu_cache();
+        perf_counters_start(&pc);
+        start = clock();
+        run_plan();
+        end = clock();
+        perf_counters_stop(&pc);
+        perf_totals_add(&plan_perf, &pc);
+        double plan_time = ((double)(end - start)) / CLOCKS_PER_SEC;
+        plan_total += plan_time;
+        printf("Compiled plan took %f seconds\n", plan_time);
+        
         // Reset the pool to ensure fair comparison in each iteration
         pool_reset(tensor_pool);
+        bitmap_pool_reset(bitmap_tensor_pool);
+        pool_set_reset(tensor_pool_set);
         
         usleep(1000);
     }
@@ -232,11 +541,71 @@ int main() {
     printf("\n--- BENCHMARK RESULTS (%d iterations) ---\n", NUM_ITERATIONS);
     printf("Standard allocator average: %f seconds\n", std_total / NUM_ITERATIONS);
     printf("Pool allocator average: %f seconds\n", pool_total / NUM_ITERATIONS);
+    printf("Bitmap pool allocator average: %f seconds\n", bitmap_total / NUM_ITERATIONS);
+    printf("Pool set allocator average: %f seconds\n", set_total / NUM_ITERATIONS);
+    printf("Pipelined pool allocator average: %f seconds\n", pipe_total / NUM_ITERATIONS);
+    printf("Compiled plan average: %f seconds\n", plan_total / NUM_ITERATIONS);
     
     double improvement = 100.0 * (std_total - pool_total) / std_total;
     printf("Improvement: %.2f%%\n", improvement);
+    printf("Bitmap pool improvement: %.2f%%\n", 100.0 * (std_total - bitmap_total) / std_total);
+    printf("Pool set improvement: %.2f%%\n", 100.0 * (std_total - set_total) / std_total);
+    printf("Pipelined pool improvement: %.2f%%\n", 100.0 * (std_total - pipe_total) / std_total);
+    printf("Compiled plan improvement: %.2f%%\n", 100.0 * (std_total - plan_total) / std_total);
+
+    perf_totals_print("Standard allocator", &std_perf);
+    perf_totals_print("Pool allocator", &pool_perf);
+    perf_totals_print("Bitmap pool allocator", &bitmap_perf);
+    perf_totals_print("Pool set allocator", &set_perf);
+    perf_totals_print("Pipelined pool allocator", &pipe_perf);
+    perf_totals_print("Compiled plan", &plan_perf);
+    perf_counters_close(&pc);
+
+    const char* sections[] = {"Standard allocator", "Pool allocator", "Bitmap pool allocator",
+                              "Pool set allocator", "Pipelined pool allocator", "Compiled plan"};
+    double averages[] = {std_total / NUM_ITERATIONS, pool_total / NUM_ITERATIONS,
+                         bitmap_total / NUM_ITERATIONS, set_total / NUM_ITERATIONS,
+                         pipe_total / NUM_ITERATIONS, plan_total / NUM_ITERATIONS};
+    perf_mode_compare("poolPerformance", ALLOC_DEBUG_BUILD, sections, averages, 6);
+    kernels_benchmark(matmul_kernels, NUM_MATMUL_KERNELS);
+
+    struct alloc_stats stats;
+    pool_get_stats(tensor_pool, &stats);
+    alloc_stats_print("Pool", &stats);
+    bitmap_pool_get_stats(bitmap_tensor_pool, &stats);
+    alloc_stats_print("Bitmap pool", &stats);
+    pool_set_get_stats(tensor_pool_set, &stats);
+    alloc_stats_print("Pool set", &stats);
+
+    // allocs stays at what compile did no matter how many runs there were
+    alloc_stats_print("Plan arena", &forward_plan->arena.stats);
+    profile_plan(NUM_ITERATIONS);
+    mlp_plan_print_timing(forward_plan);
+
+    printf("Footprint: single pool %zu bytes, pool set %zu bytes\n",
+           tensor_pool->total_blocks * tensor_pool->block_size,
+           pool_set_footprint(tensor_pool_set));
+    
+    printf("Input pipeline: %zu batches loaded, compute waited %zu times, loader waited %zu times\n",
+           atomic_load(&input_pipe->batches_loaded), input_pipe->compute_waits,
+           atomic_load(&input_pipe->loader_waits));
+    
+    input_pipeline_destroy(input_pipe);
+    
+    // the loader thread records spans too, so only now that it's joined
+#ifdef ALLOC_TRACE
+    trace_print_histograms();
+    if (trace_export_chrome("trace_pool.json") == 0) {
+        printf("Wrote trace_pool.json, open it in chrome://tracing or ui.perfetto.dev\n");
+    }
+#endif
     
+    mlp_plan_destroy(forward_plan);
     pool_destroy(tensor_pool);
+    bitmap_pool_destroy(bitmap_tensor_pool);
+    pool_set_destroy(tensor_pool_set);
+    scratch_arena_destroy(&weight_arena);
+    weight_file_close(weights);
     
     return 0;
 }
\ No newline at end of file
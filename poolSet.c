@@ -0,0 +1,114 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "poolSet.h"
+
+static size_t round_to_class(size_t size) {
+    return (size + POOL_SET_CLASS_ALIGN - 1) & ~(size_t)(POOL_SET_CLASS_ALIGN - 1);
+}
+
+struct pool_set* pool_set_create(const struct pool_class_profile* profile, size_t n,
+                                 double growth_factor) {
+    if (!profile || n == 0) return NULL;
+
+    struct pool_set* set = malloc(sizeof(struct pool_set));
+    if (!set) return NULL;
+    set->num_classes = 0;
+
+    // merge the profile into sorted classes first, pools get created after
+    size_t counts[POOL_SET_MAX_CLASSES];
+    for (size_t i = 0; i < n; i++) {
+        if (profile[i].size == 0 || profile[i].count == 0) continue;
+        size_t cls = round_to_class(profile[i].size);
+
+        size_t j = 0;
+        while (j < set->num_classes && set->class_size[j] < cls) j++;
+        if (j < set->num_classes && set->class_size[j] == cls) {
+            counts[j] += profile[i].count;
+            continue;
+        }
+
+        if (set->num_classes == POOL_SET_MAX_CLASSES) {
+            fprintf(stderr, "pool_set_create: more than %d size classes\n", POOL_SET_MAX_CLASSES);
+            free(set);
+            return NULL;
+        }
+        memmove(&set->class_size[j + 1], &set->class_size[j],
+                (set->num_classes - j) * sizeof(size_t));
+        memmove(&counts[j + 1], &counts[j], (set->num_classes - j) * sizeof(size_t));
+        set->class_size[j] = cls;
+        counts[j] = profile[i].count;
+        set->num_classes++;
+    }
+
+    for (size_t i = 0; i < set->num_classes; i++) {
+        set->pools[i] = pool_create_growable(set->class_size[i], counts[i], growth_factor, 0);
+        if (!set->pools[i]) {
+            set->num_classes = i;
+            pool_set_destroy(set);
+            return NULL;
+        }
+    }
+
+    return set;
+}
+
+static struct memory_pool* pool_for_size(struct pool_set* set, size_t size) {
+    // a handful of classes, a linear scan beats anything clever
+    for (size_t i = 0; i < set->num_classes; i++) {
+        if (size <= set->class_size[i]) return set->pools[i];
+    }
+    return NULL;
+}
+
+void* pool_set_alloc(struct pool_set* set, size_t size) {
+    if (!set) return NULL;
+    struct memory_pool* pool = pool_for_size(set, size);
+    if (!pool) return NULL;
+    return pool_alloc_sized(pool, size);
+}
+
+void pool_set_free(struct pool_set* set, void* ptr, size_t size) {
+    if (!set || !ptr) return;
+    struct memory_pool* pool = pool_for_size(set, size);
+    if (pool) pool_free(pool, ptr);
+}
+
+void pool_set_reset(struct pool_set* set) {
+    if (!set) return;
+    for (size_t i = 0; i < set->num_classes; i++) pool_reset(set->pools[i]);
+}
+
+void pool_set_destroy(struct pool_set* set) {
+    if (!set) return;
+    for (size_t i = 0; i < set->num_classes; i++) pool_destroy(set->pools[i]);
+    free(set);
+}
+
+size_t pool_set_footprint(const struct pool_set* set) {
+    size_t bytes = 0;
+    if (!set) return 0;
+    for (size_t i = 0; i < set->num_classes; i++) {
+        bytes += set->pools[i]->total_blocks * set->pools[i]->block_size;
+    }
+    return bytes;
+}
+
+void pool_set_get_stats(const struct pool_set* set, struct alloc_stats* out) {
+    if (!set || !out) return;
+    memset(out, 0, sizeof(*out));
+
+    for (size_t i = 0; i < set->num_classes; i++) {
+        const struct alloc_stats* s = &set->pools[i]->stats;
+        out->bytes_in_use += s->bytes_in_use;
+        // classes peak at different times, so this is an upper bound
+        out->peak_bytes_in_use += s->peak_bytes_in_use;
+        out->alloc_count += s->alloc_count;
+        out->free_count += s->free_count;
+        out->failed_allocs += s->failed_allocs;
+        out->slabs_created += s->slabs_created;
+        out->slabs_destroyed += s->slabs_destroyed;
+        out->bytes_requested += s->bytes_requested;
+        out->bytes_granted += s->bytes_granted;
+    }
+}
@@ -0,0 +1,40 @@
+#ifndef POOL_SET_H
+#define POOL_SET_H
+
+#include <stddef.h>
+#include "poolAllocator.h"
+
+#define POOL_SET_MAX_CLASSES 16
+#define POOL_SET_CLASS_ALIGN 64     // class sizes are rounded up to a cache line
+
+// one entry of a workload profile: count tensors of size bytes live at peak
+struct pool_class_profile {
+    size_t size;
+    size_t count;
+};
+
+// several memory_pools keyed by size class so every tensor gets a block
+// close to its own size instead of the largest one in the model
+struct pool_set {
+    struct memory_pool* pools[POOL_SET_MAX_CLASSES];
+    size_t class_size[POOL_SET_MAX_CLASSES];    // ascending
+    size_t num_classes;
+};
+
+// profile entries that round to the same class are merged and their counts
+// added up, that sum becomes the class's initial block count. pools grow by
+// growth_factor if the profile undercounts (0 keeps them fixed)
+struct pool_set* pool_set_create(const struct pool_class_profile* profile, size_t n,
+                                 double growth_factor);
+// routes to the smallest class that fits, NULL if size is bigger than all of them
+void* pool_set_alloc(struct pool_set* set, size_t size);
+// size must be the size that was passed to pool_set_alloc
+void pool_set_free(struct pool_set* set, void* ptr, size_t size);
+void pool_set_reset(struct pool_set* set);
+void pool_set_destroy(struct pool_set* set);
+// bytes of block memory reserved across every class
+size_t pool_set_footprint(const struct pool_set* set);
+// stats summed over every class
+void pool_set_get_stats(const struct pool_set* set, struct alloc_stats* out);
+
+#endif /* POOL_SET_H */
@@ -0,0 +1,217 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <math.h>
+#include "lowPrecision.h"
+#include "poolAllocator.h"
+#include "perfCounters.h"
+#include "allocDebug.h"
+#include "weightFile.h"
+
+// small batches are where narrow weights pay off, each weight gets used
+// BATCH_SIZE times per load. try -DBATCH_SIZE=1 for the memory bound case
+#ifndef BATCH_SIZE
+#define BATCH_SIZE 32
+#endif
+#define INPUT_DIM 784
+#define HIDDEN_DIM 128
+#define OUTPUT_DIM 10
+
+#define NUM_ITERATIONS 100
+
+// one storage choice for the whole network. biases stay fp32, they're tiny
+struct precision_config {
+    enum tensor_dtype weights;
+    enum tensor_dtype activations;
+};
+
+struct precision_config configs[] = {
+    {DTYPE_F32, DTYPE_F32},     // reference, everything else is compared to it
+    {DTYPE_BF16, DTYPE_BF16},
+    {DTYPE_F16, DTYPE_F16},
+    {DTYPE_I8, DTYPE_I8},
+    {DTYPE_I8, DTYPE_BF16},
+};
+#define NUM_CONFIGS (int)(sizeof(configs) / sizeof(configs[0]))
+
+// fp32 master weights, the same file poolPerformance and slabPerformance map
+const float* W1_data;
+const float* b1_data;
+const float* W2_data;
+const float* b2_data;
+float input_data[BATCH_SIZE * INPUT_DIM];   // same batch for every config
+
+float acc[BATCH_SIZE * HIDDEN_DIM];         // fp32 accumulators, reused by every layer
+
+struct qtensor W1;
+struct qtensor W2;
+struct memory_pool* tensor_pool = NULL;
+struct weight_file* weights = NULL;
+
+void load_weights(const char* path) {
+    const struct weight_spec specs[] = {
+        {"W1", INPUT_DIM, HIDDEN_DIM, &W1_data},
+        {"b1", 1, HIDDEN_DIM, &b1_data},
+        {"W2", HIDDEN_DIM, OUTPUT_DIM, &W2_data},
+        {"b2", 1, OUTPUT_DIM, &b2_data},
+    };
+    weights = weight_file_load_or_create(path, specs, sizeof(specs) / sizeof(specs[0]));
+    if (!weights) {
+        printf("Failed to load weights from %s!\n", path);
+        exit(1);
+    }
+}
+
+void add_bias_relu(float* data, const float* bias, int rows, int cols, int relu) {
+    for (int i = 0; i < rows; i++) {
+        for (int j = 0; j < cols; j++) {
+            float v = data[i * cols + j] + bias[j];
+            data[i * cols + j] = relu && v < 0.0f ? 0.0f : v;
+        }
+    }
+}
+
+// quantizes the fp32 weights into this config's storage
+void quantize_weights(const struct precision_config* cfg) {
+    qtensor_init(&W1, malloc(qtensor_bytes(cfg->weights, INPUT_DIM, HIDDEN_DIM)),
+                 INPUT_DIM, HIDDEN_DIM, cfg->weights);
+    qtensor_init(&W2, malloc(qtensor_bytes(cfg->weights, HIDDEN_DIM, OUTPUT_DIM)),
+                 HIDDEN_DIM, OUTPUT_DIM, cfg->weights);
+    if (!W1.data || !W2.data) {
+        printf("Failed to allocate weights!\n");
+        exit(1);
+    }
+    qtensor_from_f32(&W1, W1_data);
+    qtensor_from_f32(&W2, W2_data);
+}
+
+// same network as poolPerformance, hidden layers reuse the first
+// HIDDEN_DIM rows of W1. leaves the fp32 logits in output
+void run_forward(enum tensor_dtype act, float* output) {
+    struct qtensor x, h;
+    qtensor_init(&x, pool_alloc_sized(tensor_pool, qtensor_bytes(act, BATCH_SIZE, INPUT_DIM)),
+                 BATCH_SIZE, INPUT_DIM, act);
+    qtensor_from_f32(&x, input_data);
+
+    // W1 viewed as HIDDEN_DIM x HIDDEN_DIM for the hidden layers
+    struct qtensor W1_hidden = W1;
+    W1_hidden.rows = HIDDEN_DIM;
+
+    for (int layer = 0; layer < 4; layer++) {
+        matmul_mixed(&x, layer == 0 ? &W1 : &W1_hidden, acc);
+        add_bias_relu(acc, b1_data, BATCH_SIZE, HIDDEN_DIM, 1);
+
+        qtensor_init(&h, pool_alloc_sized(tensor_pool, qtensor_bytes(act, BATCH_SIZE, HIDDEN_DIM)),
+                     BATCH_SIZE, HIDDEN_DIM, act);
+        qtensor_from_f32(&h, acc);
+        pool_free(tensor_pool, x.data);
+        x = h;
+    }
+
+    matmul_mixed(&x, &W2, output);
+    add_bias_relu(output, b2_data, BATCH_SIZE, OUTPUT_DIM, 0);
+    pool_free(tensor_pool, x.data);
+}
+
+void clear_cpu_cache() {
+    int* cache_clear = (int*)malloc(32 * 1024 * 1024);
+    if (cache_clear) {
+        for (int j = 0; j < 8 * 1024 * 1024; j++) {
+            cache_clear[j] = j;
+        }
+        free(cache_clear);
+    }
+}
+
+static int argmax(const float* row, int n) {
+    int best = 0;
+    for (int j = 1; j < n; j++) {
+        if (row[j] > row[best]) best = j;
+    }
+    return best;
+}
+
+int main(int argc, char* argv[]) {
+    srand(time(NULL));
+
+    const char* weights_path = argc > 1 ? argv[1] : "weights_784x128x10.bin";
+    load_weights(weights_path);
+    for (int i = 0; i < BATCH_SIZE * INPUT_DIM; i++) {
+        input_data[i] = -5.0f + ((float)rand() / (float)RAND_MAX) * 10.0f;
+    }
+
+    printf("Running benchmarks (%s build)...\n", ALLOC_DEBUG_MODE_STR);
+
+    float reference[BATCH_SIZE * OUTPUT_DIM];
+    float output[BATCH_SIZE * OUTPUT_DIM];
+    double ref_time = 0.0;
+
+    struct perf_counters pc;
+    perf_counters_open(&pc);
+
+    printf("\n%-11s %12s %12s %12s %9s %12s %12s %8s\n", "weights/act", "weight bytes",
+           "block bytes", "sec/pass", "speedup", "max abs err", "rel l2 err", "argmax");
+
+    for (int c = 0; c < NUM_CONFIGS; c++) {
+        const struct precision_config* cfg = &configs[c];
+        quantize_weights(cfg);
+
+        // blocks sized for this activation type, the input is the biggest tensor
+        tensor_pool = pool_create(qtensor_bytes(cfg->activations, BATCH_SIZE, INPUT_DIM), 2);
+        if (!tensor_pool) {
+            printf("Failed to create memory pool!\n");
+            exit(1);
+        }
+
+        struct perf_totals perf = {0};
+        double total = 0.0;
+        for (int i = 0; i < NUM_ITERATIONS; i++) {
+            clear_cpu_cache();
+            perf_counters_start(&pc);
+            clock_t start = clock();
+            run_forward(cfg->activations, output);
+            clock_t end = clock();
+            perf_counters_stop(&pc);
+            perf_totals_add(&perf, &pc);
+            total += ((double)(end - start)) / CLOCKS_PER_SEC;
+        }
+        double avg = total / NUM_ITERATIONS;
+
+        if (c == 0) {
+            memcpy(reference, output, sizeof(reference));
+            ref_time = avg;
+        }
+
+        double max_err = 0.0, err2 = 0.0, ref2 = 0.0;
+        int matches = 0;
+        for (int i = 0; i < BATCH_SIZE * OUTPUT_DIM; i++) {
+            double d = fabs((double)output[i] - reference[i]);
+            if (d > max_err) max_err = d;
+            err2 += d * d;
+            ref2 += (double)reference[i] * reference[i];
+        }
+        for (int b = 0; b < BATCH_SIZE; b++) {
+            matches += argmax(&output[b * OUTPUT_DIM], OUTPUT_DIM) ==
+                       argmax(&reference[b * OUTPUT_DIM], OUTPUT_DIM);
+        }
+
+        char label[32];
+        snprintf(label, sizeof(label), "%s/%s", dtype_name(cfg->weights), dtype_name(cfg->activations));
+        printf("%-11s %12zu %12zu %12f %8.2fx %12g %12g %5d/%d\n", label,
+               qtensor_bytes(cfg->weights, INPUT_DIM, HIDDEN_DIM) +
+               qtensor_bytes(cfg->weights, HIDDEN_DIM, OUTPUT_DIM),
+               tensor_pool->block_size, avg, ref_time / avg, max_err,
+               ref2 > 0.0 ? sqrt(err2 / ref2) : 0.0, matches, BATCH_SIZE);
+        perf_totals_print(label, &perf);
+
+        pool_destroy(tensor_pool);
+        free(W1.data);
+        free(W2.data);
+    }
+
+    perf_counters_close(&pc);
+    weight_file_close(weights);
+
+    return 0;
+}
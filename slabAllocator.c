@@ -1,7 +1,71 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdint.h>
+#include <string.h>
 #include "slabAllocator.h"
+#include "allocDebug.h"
+#include "trace.h"
+
+#ifdef ALLOC_DEBUG
+// same scheme as the pool: [guard][payload][guard], free link in the front guard
+static int debug_is_obj(struct slab_cache *cache, struct slab *slab, void *obj) {
+    char *base = slab->memory;
+    if ((char *)obj < base || (char *)obj >= base + (size_t)slab->total_objects * cache->obj_size) {
+        return 0;
+    }
+    return (size_t)((char *)obj - base) % cache->obj_size == 0;
+}
+
+static void debug_poison_obj(struct slab_cache *cache, void *obj) {
+    ALLOC_ASAN_UNPOISON(obj, cache->obj_size);
+    memset(obj, ALLOC_POISON_FREED, cache->obj_size);
+    ALLOC_ASAN_POISON((char *)obj + sizeof(struct obj_header),
+                      cache->obj_size - sizeof(struct obj_header));
+}
+
+static void debug_check_free_obj(struct slab_cache *cache, struct slab *slab, struct obj_header *obj) {
+    if (!debug_is_obj(cache, slab, obj)) alloc_debug_fail("slab_alloc", "free list corrupted", obj);
+    if (obj->next && !debug_is_obj(cache, slab, obj->next)) {
+        alloc_debug_fail("slab_alloc", "free list link corrupted", obj->next);
+    }
+    size_t idx = (size_t)((char *)obj - (char *)slab->memory) / cache->obj_size;
+    if (alloc_bitmap_test(slab->allocated, idx)) {
+        alloc_debug_fail("slab_alloc", "free list handed out a live object", obj);
+    }
+}
+
+static void *debug_on_alloc(struct slab_cache *cache, struct slab *slab, void *obj) {
+    size_t idx = (size_t)((char *)obj - (char *)slab->memory) / cache->obj_size;
+    ALLOC_ASAN_UNPOISON(obj, cache->obj_size);
+    char *payload = (char *)obj + ALLOC_GUARD_SIZE;
+    if (!alloc_check_poison(payload, cache->payload_size)) {
+        alloc_debug_fail("slab_alloc", "object was written after free", payload);
+    }
+
+    alloc_bitmap_set(slab->allocated, idx);
+    alloc_write_canary(obj);
+    alloc_write_canary(payload + cache->payload_size);
+    memset(payload, ALLOC_POISON_FRESH, cache->payload_size);
+    return payload;
+}
+
+static void *debug_on_free(struct slab_cache *cache, struct slab *slab, void *ptr) {
+    char *obj = (char *)ptr - ALLOC_GUARD_SIZE;
+    if (!debug_is_obj(cache, slab, obj)) alloc_debug_fail("slab_free", "misaligned pointer", ptr);
+
+    size_t idx = (size_t)(obj - (char *)slab->memory) / cache->obj_size;
+    if (!alloc_bitmap_test(slab->allocated, idx)) alloc_debug_fail("slab_free", "double free", ptr);
+
+    if (!alloc_check_canary(obj)) alloc_debug_fail("slab_free", "buffer underflow", ptr);
+    if (!alloc_check_canary((char *)ptr + cache->payload_size)) {
+        alloc_debug_fail("slab_free", "buffer overflow", ptr);
+    }
+
+    alloc_bitmap_clear(slab->allocated, idx);
+    debug_poison_obj(cache, obj);
+    return obj;
+}
+#endif
 
 struct slab* create_slab(struct slab_cache *cache) {
     struct slab *slab = malloc(sizeof(struct slab));
@@ -15,6 +79,18 @@ struct slab* create_slab(struct slab_cache *cache) {
     
     slab->total_objects = cache->slab_size / cache->obj_size;
     slab->free_objects = slab->total_objects;
+
+#ifdef ALLOC_DEBUG
+    slab->allocated = alloc_bitmap_create(slab->total_objects);
+    if (!slab->allocated) {
+        free(slab->memory);
+        free(slab);
+        return NULL;
+    }
+    for (size_t i = 0; i < slab->total_objects; i++) {
+        debug_poison_obj(cache, (char *)slab->memory + i * cache->obj_size);
+    }
+#endif
     
     //free list set up 
     char *current = (char *)slab->memory;
@@ -27,6 +103,7 @@ struct slab* create_slab(struct slab_cache *cache) {
         obj->next = (struct obj_header *)current;
     }
     ((struct obj_header *)current)->next = NULL;
+    STATS_SLAB_CREATED(&cache->stats);
     
     return slab;
 }
@@ -37,19 +114,25 @@ struct slab_cache* create_cache(size_t obj_size) {
 
     cache->obj_size = obj_size < sizeof(struct obj_header) ? 
                      sizeof(struct obj_header) : obj_size;
+    cache->requested_size = obj_size;
+#ifdef ALLOC_DEBUG
+    cache->payload_size = cache->obj_size;
+    cache->obj_size = (cache->payload_size + 2 * ALLOC_GUARD_SIZE + 15) & ~(size_t)15;
+#endif
     
-    if (obj_size > 1024) {
-        cache->slab_size = 4096 * ((obj_size / 4096) + 1);
+    if (cache->obj_size > 1024) {
+        cache->slab_size = 4096 * ((cache->obj_size / 4096) + 1);
         printf("Using larger slab size: %zu bytes\n", cache->slab_size);
     } else {
         cache->slab_size = 4096;  
     }
     
     cache->slabs = NULL;
+    memset(&cache->stats, 0, sizeof(cache->stats));
     return cache;
 }
 
-void* slab_alloc(struct slab_cache *cache) {
+static void* slab_alloc_obj(struct slab_cache *cache) {
     struct slab *slab = cache->slabs;
     struct slab *prev = NULL;
     
@@ -60,20 +143,37 @@ void* slab_alloc(struct slab_cache *cache) {
     
     if (!slab) {
         slab = create_slab(cache);
-        if (!slab) return NULL;
+        if (!slab) {
+            STATS_FAIL(&cache->stats);
+            return NULL;
+        }
         
         slab->next = cache->slabs;
         cache->slabs = slab;
     }
     
     void *obj = slab->free;
+#ifdef ALLOC_DEBUG
+    debug_check_free_obj(cache, slab, obj);
+#endif
     slab->free = slab->free->next;
     slab->free_objects--;
+    STATS_ALLOC(&cache->stats, cache->requested_size, cache->obj_size);
     
+#ifdef ALLOC_DEBUG
+    return debug_on_alloc(cache, slab, obj);
+#endif
     return obj;
 }
 
-void slab_free(struct slab_cache *cache, void *ptr) {
+void* slab_alloc(struct slab_cache *cache) {
+    TRACE_BEGIN("slab_alloc");
+    void *obj = slab_alloc_obj(cache);
+    TRACE_END("slab_alloc");
+    return obj;
+}
+
+static void slab_free_obj(struct slab_cache *cache, void *ptr) {
     struct slab *slab = cache->slabs;
     
     while (slab) {
@@ -84,13 +184,29 @@ void slab_free(struct slab_cache *cache, void *ptr) {
         slab = slab->next;
     }
     
-    if (!slab) return;  // Bad pointer
+    if (!slab) {
+#ifdef ALLOC_DEBUG
+        alloc_debug_fail("slab_free", "pointer not from this cache", ptr);
+#endif
+        return;  // Bad pointer
+    }
+
+#ifdef ALLOC_DEBUG
+    ptr = debug_on_free(cache, slab, ptr);
+#endif
     
     // add to free list
     struct obj_header *obj = ptr;
     obj->next = slab->free;
     slab->free = obj;
     slab->free_objects++;
+    STATS_FREE(&cache->stats, cache->obj_size);
+}
+
+void slab_free(struct slab_cache *cache, void *ptr) {
+    TRACE_BEGIN("slab_free");
+    slab_free_obj(cache, ptr);
+    TRACE_END("slab_free");
 }
 
 void destroy_cache(struct slab_cache *cache) {
@@ -99,10 +215,20 @@ void destroy_cache(struct slab_cache *cache) {
     struct slab *slab = cache->slabs;
     while (slab) {
         struct slab *next = slab->next;
+#ifdef ALLOC_DEBUG
+        ALLOC_ASAN_UNPOISON(slab->memory, cache->slab_size);
+        free(slab->allocated);
+#endif
         free(slab->memory);
         free(slab);
+        STATS_SLAB_DESTROYED(&cache->stats);
         slab = next;
     }
     
     free(cache);
-}
\ No newline at end of file
+}
+
+void slab_get_stats(const struct slab_cache *cache, struct alloc_stats *out) {
+    if (!cache || !out) return;
+    *out = cache->stats;
+}
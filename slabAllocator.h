@@ -3,6 +3,7 @@
 
 #include <stdint.h>
 #include <stdlib.h>
+#include "allocStats.h"
 
 struct obj_header {
     struct obj_header *next;
@@ -14,12 +15,20 @@ struct slab {
     uint16_t free_objects;
     uint16_t total_objects;
     struct obj_header *free;
+#ifdef ALLOC_DEBUG
+    uint8_t *allocated;     // one bit per object, catches double frees
+#endif
 };
 
 struct slab_cache {
     size_t obj_size;
+    size_t requested_size;  // obj_size before rounding up to fit an obj_header
     size_t slab_size;
     struct slab *slabs;
+    struct alloc_stats stats;
+#ifdef ALLOC_DEBUG
+    size_t payload_size;    // obj_size minus the guards around each object
+#endif
 };
 
 struct slab_cache* create_cache(size_t obj_size);
@@ -27,5 +36,6 @@ void* slab_alloc(struct slab_cache *cache);
 void slab_free(struct slab_cache *cache, void *ptr);
 struct slab* create_slab(struct slab_cache *cache);
 void destroy_cache(struct slab_cache *cache);
+void slab_get_stats(const struct slab_cache *cache, struct alloc_stats *out);
 
 #endif
\ No newline at end of file
@@ -5,25 +5,41 @@
 #include <math.h>
 #include <unistd.h>
 #include "slabAllocator.h"
+#include "perfCounters.h"
+#include "allocDebug.h"
+#include "kernels.h"
+#include "threadArena.h"
+#include "trace.h"
+#include "weightFile.h"
 
 #define BATCH_SIZE 32
 #define INPUT_DIM 784
 #define HIDDEN_DIM 128
 #define OUTPUT_DIM 10
 
-typedef struct {
-    void* data;
-    int rows;
-    int cols;
-} Tensor;
-
-float W1_data[INPUT_DIM * HIDDEN_DIM];
-float b1_data[HIDDEN_DIM];
-float W2_data[HIDDEN_DIM * OUTPUT_DIM];
-float b2_data[OUTPUT_DIM];
+const float* W1_data;
+const float* b1_data;
+const float* W2_data;
+const float* b2_data;
 Tensor W1;
 Tensor W2;
 
+struct weight_file* weights = NULL;
+
+void load_weights(const char* path) {
+    const struct weight_spec specs[] = {
+        {"W1", INPUT_DIM, HIDDEN_DIM, &W1_data},
+        {"b1", 1, HIDDEN_DIM, &b1_data},
+        {"W2", HIDDEN_DIM, OUTPUT_DIM, &W2_data},
+        {"b2", 1, OUTPUT_DIM, &b2_data},
+    };
+    weights = weight_file_load_or_create(path, specs, sizeof(specs) / sizeof(specs[0]));
+    if (!weights) {
+        printf("Failed to load weights from %s!\n", path);
+        exit(1);
+    }
+}
+
 struct slab_cache* tensor_cache = NULL;
 
 void init_slab_system() {
@@ -37,9 +53,18 @@ void init_slab_system() {
     }
 }
 
+void* std_malloc(size_t size) {
+    TRACE_BEGIN("malloc");
+    void* ptr = malloc(size);
+    TRACE_END("malloc");
+    return ptr;
+}
+
 void free_tensor(Tensor* t) {
     if (t && t->data) {
+        TRACE_BEGIN("free");
         free(t->data);
+        TRACE_END("free");
         t->data = NULL;
     }
 }
@@ -51,47 +76,67 @@ void free_slab_tensor(Tensor* t) {
     }
 }
 
-void matmul(const Tensor* A, const Tensor* B, Tensor* out) {
-    float* a = (float*)A->data;
-    float* b = (float*)B->data;
-    float* c = (float*)out->data;
-    
-    for (int i = 0; i < A->rows; i++) {
-        for (int j = 0; j < B->cols; j++) {
-            c[i * out->cols + j] = 0;
-            for (int k = 0; k < A->cols; k++) {
-                c[i * out->cols + j] += a[i * A->cols + k] * b[k * B->cols + j];
-            }
-        }
+// one kernel per layer shape the forward pass actually runs
+MATMUL_KERNEL(BATCH_SIZE, INPUT_DIM, HIDDEN_DIM)
+MATMUL_KERNEL(BATCH_SIZE, HIDDEN_DIM, HIDDEN_DIM)
+MATMUL_KERNEL(BATCH_SIZE, HIDDEN_DIM, OUTPUT_DIM)
+
+const struct matmul_kernel matmul_kernels[] = {
+    MATMUL_KERNEL_ENTRY(BATCH_SIZE, INPUT_DIM, HIDDEN_DIM),
+    MATMUL_KERNEL_ENTRY(BATCH_SIZE, HIDDEN_DIM, HIDDEN_DIM),
+    MATMUL_KERNEL_ENTRY(BATCH_SIZE, HIDDEN_DIM, OUTPUT_DIM),
+};
+#define NUM_MATMUL_KERNELS (int)(sizeof(matmul_kernels) / sizeof(matmul_kernels[0]))
+
+struct scratch_arena weight_arena;     // packed weights, lives as long as the program
+
+// done once at startup, every forward pass after this streams the panels
+void pack_weights() {
+    // the hidden layers run the first HIDDEN_DIM rows of W1, that fits as is
+    int w1_rows = INPUT_DIM > HIDDEN_DIM ? INPUT_DIM : HIDDEN_DIM;
+    size_t bytes = matmul_packed_size(w1_rows, HIDDEN_DIM) + matmul_packed_size(HIDDEN_DIM, OUTPUT_DIM);
+    if (!scratch_arena_init(&weight_arena, bytes + 64)) {
+        printf("Failed to create weight arena!\n");
+        exit(1);
     }
+    pack_weight(&weight_arena, &W1, w1_rows);
+    pack_weight(&weight_arena, &W2, HIDDEN_DIM);
+}
+
+void matmul(const Tensor* A, const Tensor* B, Tensor* out) {
+    kernels_matmul(matmul_kernels, NUM_MATMUL_KERNELS, A, B, out);
 }
 
 void add_bias(Tensor* out, const float* bias) {
     float* data = (float*)out->data;
+    TRACE_BEGIN("add_bias");
     for (int i = 0; i < out->rows; i++) {
         for (int j = 0; j < out->cols; j++) {
             data[i * out->cols + j] += bias[j];
         }
     }
+    TRACE_END("add_bias");
 }
 
 void relu(Tensor* t) {
     float* data = (float*)t->data;
     int size = t->rows * t->cols;
+    TRACE_BEGIN("relu");
     for (int i = 0; i < size; i++) {
         if (data[i] < 0) {
             data[i] = 0;
         }
     }
+    TRACE_END("relu");
 }
 
 void run_standard_allocator() {
-    Tensor input = {malloc(sizeof(float)*BATCH_SIZE*INPUT_DIM), BATCH_SIZE, INPUT_DIM};
-    Tensor h1 = {malloc(sizeof(float)*BATCH_SIZE*HIDDEN_DIM), BATCH_SIZE, HIDDEN_DIM};
-    Tensor h2 = {malloc(sizeof(float)*BATCH_SIZE*HIDDEN_DIM), BATCH_SIZE, HIDDEN_DIM};
-    Tensor h3 = {malloc(sizeof(float)*BATCH_SIZE*HIDDEN_DIM), BATCH_SIZE, HIDDEN_DIM};
-    Tensor h4 = {malloc(sizeof(float)*BATCH_SIZE*HIDDEN_DIM), BATCH_SIZE, HIDDEN_DIM};
-    Tensor output = {malloc(sizeof(float)*BATCH_SIZE*OUTPUT_DIM), BATCH_SIZE, OUTPUT_DIM};
+    Tensor input = {std_malloc(sizeof(float)*BATCH_SIZE*INPUT_DIM), BATCH_SIZE, INPUT_DIM, LAYOUT_ROW_MAJOR};
+    Tensor h1 = {std_malloc(sizeof(float)*BATCH_SIZE*HIDDEN_DIM), BATCH_SIZE, HIDDEN_DIM, LAYOUT_ROW_MAJOR};
+    Tensor h2 = {std_malloc(sizeof(float)*BATCH_SIZE*HIDDEN_DIM), BATCH_SIZE, HIDDEN_DIM, LAYOUT_ROW_MAJOR};
+    Tensor h3 = {std_malloc(sizeof(float)*BATCH_SIZE*HIDDEN_DIM), BATCH_SIZE, HIDDEN_DIM, LAYOUT_ROW_MAJOR};
+    Tensor h4 = {std_malloc(sizeof(float)*BATCH_SIZE*HIDDEN_DIM), BATCH_SIZE, HIDDEN_DIM, LAYOUT_ROW_MAJOR};
+    Tensor output = {std_malloc(sizeof(float)*BATCH_SIZE*OUTPUT_DIM), BATCH_SIZE, OUTPUT_DIM, LAYOUT_ROW_MAJOR};
     
     for (int i = 0; i < BATCH_SIZE*INPUT_DIM; i++) {
         ((float*)input.data)[i] = -5.0f + ((float)rand() / (float)RAND_MAX) * 10.0f;
@@ -125,12 +170,12 @@ void run_standard_allocator() {
 }
 
 void run_slab_allocator() {
-    Tensor input = {slab_alloc(tensor_cache), BATCH_SIZE, INPUT_DIM};
-    Tensor h1 = {slab_alloc(tensor_cache), BATCH_SIZE, HIDDEN_DIM};
-    Tensor h2 = {slab_alloc(tensor_cache), BATCH_SIZE, HIDDEN_DIM};
-    Tensor h3 = {slab_alloc(tensor_cache), BATCH_SIZE, HIDDEN_DIM};
-    Tensor h4 = {slab_alloc(tensor_cache), BATCH_SIZE, HIDDEN_DIM};
-    Tensor output = {slab_alloc(tensor_cache), BATCH_SIZE, OUTPUT_DIM};
+    Tensor input = {slab_alloc(tensor_cache), BATCH_SIZE, INPUT_DIM, LAYOUT_ROW_MAJOR};
+    Tensor h1 = {slab_alloc(tensor_cache), BATCH_SIZE, HIDDEN_DIM, LAYOUT_ROW_MAJOR};
+    Tensor h2 = {slab_alloc(tensor_cache), BATCH_SIZE, HIDDEN_DIM, LAYOUT_ROW_MAJOR};
+    Tensor h3 = {slab_alloc(tensor_cache), BATCH_SIZE, HIDDEN_DIM, LAYOUT_ROW_MAJOR};
+    Tensor h4 = {slab_alloc(tensor_cache), BATCH_SIZE, HIDDEN_DIM, LAYOUT_ROW_MAJOR};
+    Tensor output = {slab_alloc(tensor_cache), BATCH_SIZE, OUTPUT_DIM, LAYOUT_ROW_MAJOR};
     
     for (int i = 0; i < BATCH_SIZE*INPUT_DIM; i++) {
         ((float*)input.data)[i] = -5.0f + ((float)rand() / (float)RAND_MAX) * 10.0f;
@@ -173,51 +218,57 @@ void clear_cpu_cache() {
     }
 }
 
-int main() {
+int main(int argc, char* argv[]) {
     srand(time(NULL));
     
-    for(int i = 0; i < INPUT_DIM * HIDDEN_DIM; i++) {
-        W1_data[i] = -0.5f + ((float)rand() / (float)RAND_MAX);
-    }
-    for(int i = 0; i < HIDDEN_DIM; i++) {
-        b1_data[i] = -0.5f + ((float)rand() / (float)RAND_MAX);
-    }
-    for(int i = 0; i < HIDDEN_DIM * OUTPUT_DIM; i++) {
-        W2_data[i] = -0.5f + ((float)rand() / (float)RAND_MAX);
-    }
-    for(int i = 0; i < OUTPUT_DIM; i++) {
-        b2_data[i] = -0.5f + ((float)rand() / (float)RAND_MAX);
-    }
+    const char* weights_path = argc > 1 ? argv[1] : "weights_784x128x10.bin";
+    struct timespec load_start, load_end;
+    clock_gettime(CLOCK_MONOTONIC, &load_start);
+    load_weights(weights_path);
+    clock_gettime(CLOCK_MONOTONIC, &load_end);
+    printf("Mapped %zu bytes of weights from %s in %f seconds\n", weights->size, weights_path,
+           (load_end.tv_sec - load_start.tv_sec) + (load_end.tv_nsec - load_start.tv_nsec) / 1e9);
     
-    W1.data = W1_data;
+    W1.data = (void*)W1_data;
     W1.rows = INPUT_DIM;
     W1.cols = HIDDEN_DIM;
     
-    W2.data = W2_data;
+    W2.data = (void*)W2_data;
     W2.rows = HIDDEN_DIM;
     W2.cols = OUTPUT_DIM;
+    pack_weights();
     
     init_slab_system();
     
-    printf("Running benchmarks...\n");
+    printf("Running benchmarks (%s build)...\n", ALLOC_DEBUG_MODE_STR);
     
     const int NUM_ITERATIONS = 100;
     double std_total = 0.0, slab_total = 0.0;
     clock_t start, end;
+
+    struct perf_counters pc;
+    struct perf_totals std_perf = {0}, slab_perf = {0};
+    perf_counters_open(&pc);
     
     for (int i = 0; i < NUM_ITERATIONS; i++) {
         clear_cpu_cache();
+        perf_counters_start(&pc);
         start = clock();
         run_standard_allocator();
         end = clock();
+        perf_counters_stop(&pc);
+        perf_totals_add(&std_perf, &pc);
         double std_time = ((double)(end - start)) / CLOCKS_PER_SEC;
         std_total += std_time;
         printf("Standard allocator took %f seconds\n", std_time);
         
         clear_cpu_cache();
+        perf_counters_start(&pc);
         start = clock();
         run_slab_allocator();
         end = clock();
+        perf_counters_stop(&pc);
+        perf_totals_add(&slab_perf, &pc);
         double slab_time = ((double)(end - start)) / CLOCKS_PER_SEC;
         slab_total += slab_time;
         printf("Slab allocator took %f seconds\n", slab_time);
@@ -231,8 +282,29 @@ int main() {
     
     double improvement = 100.0 * (std_total - slab_total) / std_total;
     printf("Improvement: %.2f%%\n", improvement);
+
+    perf_totals_print("Standard allocator", &std_perf);
+    perf_totals_print("Slab allocator", &slab_perf);
+    perf_counters_close(&pc);
+
+    const char* sections[] = {"Standard allocator", "Slab allocator"};
+    double averages[] = {std_total / NUM_ITERATIONS, slab_total / NUM_ITERATIONS};
+    perf_mode_compare("slabPerformance", ALLOC_DEBUG_BUILD, sections, averages, 2);
+
+    struct alloc_stats stats;
+    slab_get_stats(tensor_cache, &stats);
+    alloc_stats_print("Slab", &stats);
+    
+#ifdef ALLOC_TRACE
+    trace_print_histograms();
+    if (trace_export_chrome("trace_slab.json") == 0) {
+        printf("Wrote trace_slab.json, open it in chrome://tracing or ui.perfetto.dev\n");
+    }
+#endif
     
     destroy_cache(tensor_cache);
+    scratch_arena_destroy(&weight_arena);
+    weight_file_close(weights);
     
     return 0;
 }
\ No newline at end of file
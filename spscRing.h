@@ -0,0 +1,57 @@
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <stdlib.h>
+#include <stdatomic.h>
+
+#define SPSC_CACHE_LINE 64
+
+// single producer / single consumer queue of pointers. exactly one thread
+// pushes and exactly one thread pops, so head and tail each have a single
+// writer and a pair of acquire/release atomics is all the sync we need.
+// they sit on separate cache lines so the two threads don't false share
+struct spsc_ring {
+    _Alignas(SPSC_CACHE_LINE) _Atomic size_t head;     // next slot to pop, consumer writes
+    _Alignas(SPSC_CACHE_LINE) _Atomic size_t tail;     // next slot to push, producer writes
+    _Alignas(SPSC_CACHE_LINE) void** slots;
+    size_t mask;                                        // capacity - 1, capacity is a power of 2
+};
+
+// capacity gets rounded up to a power of 2, returns 0 if malloc fails
+static inline int spsc_ring_init(struct spsc_ring* ring, size_t capacity) {
+    size_t cap = 1;
+    while (cap < capacity) cap <<= 1;
+    ring->slots = malloc(cap * sizeof(void*));
+    if (!ring->slots) return 0;
+    ring->mask = cap - 1;
+    atomic_init(&ring->head, 0);
+    atomic_init(&ring->tail, 0);
+    return 1;
+}
+
+static inline void spsc_ring_destroy(struct spsc_ring* ring) {
+    free(ring->slots);
+    ring->slots = NULL;
+}
+
+// producer only, 0 if the ring is full
+static inline int spsc_ring_push(struct spsc_ring* ring, void* item) {
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    size_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    if (tail - head > ring->mask) return 0;
+    ring->slots[tail & ring->mask] = item;
+    atomic_store_explicit(&ring->tail, tail + 1, memory_order_release);
+    return 1;
+}
+
+// consumer only, NULL if the ring is empty
+static inline void* spsc_ring_pop(struct spsc_ring* ring) {
+    size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    if (head == tail) return NULL;
+    void* item = ring->slots[head & ring->mask];
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+    return item;
+}
+
+#endif /* SPSC_RING_H */
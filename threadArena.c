@@ -0,0 +1,175 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "threadArena.h"
+#include "allocDebug.h"
+#include "trace.h"
+
+#define SCRATCH_ALIGN 16
+
+static _Thread_local struct scratch_arena tls_arena;
+static _Thread_local int tls_arena_ready;
+
+int scratch_arena_init(struct scratch_arena* arena, size_t capacity) {
+    memset(arena, 0, sizeof(*arena));
+    arena->memory = malloc(capacity);
+    if (!arena->memory) return 0;
+    arena->capacity = capacity;
+    STATS_SLAB_CREATED(&arena->stats);
+    ALLOC_ASAN_POISON(arena->memory, arena->capacity);
+    return 1;
+}
+
+static void* spill_alloc(struct scratch_arena* arena, size_t size) {
+    // header padded so the payload keeps SCRATCH_ALIGN alignment
+    struct spill_block* block = malloc(SCRATCH_ALIGN + size);
+    if (!block) return NULL;
+    block->next = arena->spill;
+    arena->spill = block;
+    arena->spill_bytes += size;
+    return (char*)block + SCRATCH_ALIGN;
+}
+
+void* scratch_arena_alloc(struct scratch_arena* arena, size_t size) {
+    size_t requested = size;
+    size = (size + SCRATCH_ALIGN - 1) & ~(size_t)(SCRATCH_ALIGN - 1);
+
+    void* ptr;
+    if (arena->used + size <= arena->capacity) {
+        ptr = arena->memory + arena->used;
+        arena->used += size;
+        ALLOC_ASAN_UNPOISON(ptr, size);
+    } else {
+        ptr = spill_alloc(arena, size);
+        if (!ptr) {
+            STATS_FAIL(&arena->stats);
+            return NULL;
+        }
+    }
+
+    arena->live_allocs++;
+    size_t in_use = arena->used + arena->spill_bytes;
+    if (in_use > arena->request_peak) arena->request_peak = in_use;
+    STATS_ALLOC(&arena->stats, requested, size);
+    return ptr;
+}
+
+void scratch_arena_reset(struct scratch_arena* arena) {
+    while (arena->spill) {
+        struct spill_block* next = arena->spill->next;
+        free(arena->spill);
+        arena->spill = next;
+    }
+#ifdef ALLOC_DEBUG
+    memset(arena->memory, ALLOC_POISON_FREED, arena->used);
+#endif
+    ALLOC_ASAN_POISON(arena->memory, arena->capacity);
+
+    arena->used = 0;
+    arena->spill_bytes = 0;
+    arena->request_peak = 0;
+    STATS_FREE_ALL(&arena->stats, arena->live_allocs);
+    arena->live_allocs = 0;
+}
+
+void scratch_arena_destroy(struct scratch_arena* arena) {
+    scratch_arena_reset(arena);
+    ALLOC_ASAN_UNPOISON(arena->memory, arena->capacity);
+    free(arena->memory);
+    arena->memory = NULL;
+    arena->capacity = 0;
+    STATS_SLAB_DESTROYED(&arena->stats);
+}
+
+// swaps the (empty) arena's region for one of a new size
+static void scratch_arena_resize(struct scratch_arena* arena, size_t capacity) {
+    char* memory = malloc(capacity);
+    if (!memory) return; // keep the old one, still correct just not ideal
+
+    ALLOC_ASAN_UNPOISON(arena->memory, arena->capacity);
+    free(arena->memory);
+    arena->memory = memory;
+    arena->capacity = capacity;
+    ALLOC_ASAN_POISON(arena->memory, arena->capacity);
+    STATS_SLAB_DESTROYED(&arena->stats);
+    STATS_SLAB_CREATED(&arena->stats);
+}
+
+static size_t next_pow2(size_t x) {
+    size_t p = THREAD_ARENA_MIN_SIZE;
+    while (p < x) p <<= 1;
+    return p;
+}
+
+struct scratch_arena* thread_arena() {
+    if (!tls_arena_ready) {
+        if (!scratch_arena_init(&tls_arena, THREAD_ARENA_INITIAL_SIZE)) {
+            printf("Failed to create thread arena!\n");
+            exit(1);
+        }
+        tls_arena_ready = 1;
+    }
+    return &tls_arena;
+}
+
+void thread_arena_release() {
+    if (!tls_arena_ready) return;
+    scratch_arena_destroy(&tls_arena);
+    tls_arena_ready = 0;
+}
+
+void request_begin() {
+    struct scratch_arena* arena = thread_arena();
+    if (arena->in_request) {
+        fprintf(stderr, "request_begin: previous request never ended\n");
+        scratch_arena_reset(arena);
+    }
+    arena->in_request = 1;
+}
+
+void* request_alloc(size_t size) {
+    struct scratch_arena* arena = thread_arena();
+    if (!arena->in_request) {
+        // nothing would ever release it, or the next request_end would
+        // free it from under whoever holds it
+#ifdef ALLOC_DEBUG
+        alloc_debug_fail("request_alloc", "no request open", NULL);
+#endif
+        fprintf(stderr, "request_alloc: no request open\n");
+        return NULL;
+    }
+    TRACE_BEGIN("request_alloc");
+    void* ptr = scratch_arena_alloc(arena, size);
+    TRACE_END("request_alloc");
+    return ptr;
+}
+
+void request_end() {
+    struct scratch_arena* arena = thread_arena();
+    if (!arena->in_request) {
+        fprintf(stderr, "request_end: no request open\n");
+        return;
+    }
+    TRACE_BEGIN("request_end");
+    size_t peak = arena->request_peak;
+    int spilled = arena->spill != NULL;
+
+    scratch_arena_reset(arena);
+    arena->in_request = 0;
+
+    if (peak > arena->window_peak) arena->window_peak = peak;
+    arena->window_requests++;
+
+    if (spilled) {
+        // a quarter of headroom so a slightly bigger request next time fits
+        scratch_arena_resize(arena, next_pow2(peak + peak / 4));
+        arena->window_peak = 0;
+        arena->window_requests = 0;
+    } else if (arena->window_requests == THREAD_ARENA_WINDOW) {
+        size_t target = next_pow2(2 * arena->window_peak);
+        if (arena->capacity > 2 * target) scratch_arena_resize(arena, target);
+        arena->window_peak = 0;
+        arena->window_requests = 0;
+    }
+    TRACE_END("request_end");
+}
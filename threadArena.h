@@ -0,0 +1,56 @@
+#ifndef THREAD_ARENA_H
+#define THREAD_ARENA_H
+
+#include <stddef.h>
+#include "allocStats.h"
+
+#define THREAD_ARENA_INITIAL_SIZE (256 * 1024)
+#define THREAD_ARENA_MIN_SIZE (64 * 1024)
+#define THREAD_ARENA_WINDOW 64      // requests between shrink decisions
+
+// bump allocation that doesn't fit goes to malloc'd spill blocks
+// instead of failing, they live until the next reset
+struct spill_block {
+    struct spill_block* next;
+};
+
+// bump arena like tensor_arena in allocator.c, but an instance type so
+// every thread (or anything else that wants one) can own its own
+struct scratch_arena {
+    char* memory;
+    size_t capacity;
+    size_t used;
+    struct spill_block* spill;
+    size_t spill_bytes;
+    size_t live_allocs;     // allocations since the last reset, all freed by it
+
+    size_t request_peak;    // used + spill_bytes high water since the last reset
+    size_t window_peak;     // max request_peak over the current window
+    int window_requests;
+    int in_request;
+
+    struct alloc_stats stats;
+};
+
+int scratch_arena_init(struct scratch_arena* arena, size_t capacity);
+// 16-byte aligned, never NULL unless malloc itself fails
+void* scratch_arena_alloc(struct scratch_arena* arena, size_t size);
+// drops everything, frees spill blocks, keeps the capacity
+void scratch_arena_reset(struct scratch_arena* arena);
+void scratch_arena_destroy(struct scratch_arena* arena);
+
+// the calling thread's arena, created on first use
+struct scratch_arena* thread_arena();
+// workers call this before exiting, thread locals aren't freed for us
+void thread_arena_release();
+
+// one inference = one request. everything from request_alloc is
+// released at request_end, which also resizes the thread's arena:
+// grows right away if the request spilled, shrinks when a whole window
+// of requests used well under the capacity
+void request_begin();
+// NULL outside a request_begin/request_end pair (aborts with ALLOC_DEBUG)
+void* request_alloc(size_t size);
+void request_end();
+
+#endif /* THREAD_ARENA_H */
@@ -0,0 +1,265 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include "tlsfAllocator.h"
+#include "allocDebug.h"
+#include "trace.h"
+
+#define BLOCK_FREE      ((size_t)1)     // this block is free
+#define BLOCK_PREV_FREE ((size_t)2)     // the physically previous block is free
+#define BLOCK_FLAGS     (BLOCK_FREE | BLOCK_PREV_FREE)
+
+#define BLOCK_HEADER  offsetof(struct tlsf_block, next_free)
+#define BLOCK_MIN     (sizeof(struct tlsf_block) - BLOCK_HEADER)   // room for the free links
+#define BLOCK_MAX     (((size_t)1 << TLSF_FL_MAX) - TLSF_ALIGN)
+
+static inline size_t block_size(const struct tlsf_block* b) { return b->size & ~BLOCK_FLAGS; }
+static inline int block_is_free(const struct tlsf_block* b) { return (b->size & BLOCK_FREE) != 0; }
+static inline int block_prev_free(const struct tlsf_block* b) { return (b->size & BLOCK_PREV_FREE) != 0; }
+
+static inline void block_set_size(struct tlsf_block* b, size_t size) {
+    b->size = size | (b->size & BLOCK_FLAGS);
+}
+
+static inline void* block_to_ptr(struct tlsf_block* b) { return (char*)b + BLOCK_HEADER; }
+static inline struct tlsf_block* block_from_ptr(const void* ptr) {
+    return (struct tlsf_block*)((char*)ptr - BLOCK_HEADER);
+}
+
+static inline struct tlsf_block* block_next(struct tlsf_block* b) {
+    return (struct tlsf_block*)((char*)block_to_ptr(b) + block_size(b));
+}
+
+// flip b's free flag and tell the next block about it
+static inline void block_mark_free(struct tlsf_block* b) {
+    struct tlsf_block* next = block_next(b);
+    next->prev_phys = b;
+    next->size |= BLOCK_PREV_FREE;
+    b->size |= BLOCK_FREE;
+}
+
+static inline void block_mark_used(struct tlsf_block* b) {
+    block_next(b)->size &= ~BLOCK_PREV_FREE;
+    b->size &= ~BLOCK_FREE;
+}
+
+static inline int fls_size(size_t x) { return 63 - __builtin_clzll(x); }
+
+// size -> (fl, sl) list that holds blocks of exactly this class
+static void mapping_insert(size_t size, int* fl, int* sl) {
+    if (size < TLSF_SMALL_BLOCK) {
+        *fl = 0;
+        *sl = (int)(size / (TLSF_SMALL_BLOCK / TLSF_SL_COUNT));
+    } else {
+        int f = fls_size(size);
+        *sl = (int)((size >> (f - TLSF_SL_LOG2)) ^ (1 << TLSF_SL_LOG2));
+        *fl = f - (TLSF_FL_SHIFT - 1);
+    }
+}
+
+// like mapping_insert but rounds up to the next list, so any block found
+// there is guaranteed big enough and we never walk a list
+static void mapping_search(size_t size, int* fl, int* sl) {
+    if (size >= TLSF_SMALL_BLOCK) {
+        size += ((size_t)1 << (fls_size(size) - TLSF_SL_LOG2)) - 1;
+    }
+    mapping_insert(size, fl, sl);
+}
+
+static struct tlsf_block* search_suitable(struct tlsf_allocator* tlsf, int* fl, int* sl) {
+    uint32_t sl_map = tlsf->sl_bitmap[*fl] & (~0U << *sl);
+    if (!sl_map) {
+        uint32_t fl_map = (*fl + 1 < 32) ? tlsf->fl_bitmap & (~0U << (*fl + 1)) : 0;
+        if (!fl_map) return NULL;
+        *fl = __builtin_ctz(fl_map);
+        sl_map = tlsf->sl_bitmap[*fl];
+    }
+    *sl = __builtin_ctz(sl_map);
+    return tlsf->blocks[*fl][*sl];
+}
+
+static void remove_free_block(struct tlsf_allocator* tlsf, struct tlsf_block* b, int fl, int sl) {
+    struct tlsf_block* prev = b->prev_free;
+    struct tlsf_block* next = b->next_free;
+    if (next) next->prev_free = prev;
+    if (prev) {
+        prev->next_free = next;
+    } else {
+        tlsf->blocks[fl][sl] = next;
+        if (!next) {
+            tlsf->sl_bitmap[fl] &= ~(1U << sl);
+            if (!tlsf->sl_bitmap[fl]) tlsf->fl_bitmap &= ~(1U << fl);
+        }
+    }
+}
+
+static void insert_free_block(struct tlsf_allocator* tlsf, struct tlsf_block* b) {
+    int fl, sl;
+    mapping_insert(block_size(b), &fl, &sl);
+
+    struct tlsf_block* head = tlsf->blocks[fl][sl];
+    b->next_free = head;
+    b->prev_free = NULL;
+    if (head) head->prev_free = b;
+    tlsf->blocks[fl][sl] = b;
+    tlsf->fl_bitmap |= 1U << fl;
+    tlsf->sl_bitmap[fl] |= 1U << sl;
+}
+
+static void remove_block(struct tlsf_allocator* tlsf, struct tlsf_block* b) {
+    int fl, sl;
+    mapping_insert(block_size(b), &fl, &sl);
+    remove_free_block(tlsf, b, fl, sl);
+}
+
+struct tlsf_allocator* tlsf_create(size_t bytes) {
+    bytes &= ~(size_t)(TLSF_ALIGN - 1);
+    // one real block plus the zero sized sentinel that ends the region
+    if (bytes < 2 * BLOCK_HEADER + BLOCK_MIN || bytes - 2 * BLOCK_HEADER > BLOCK_MAX) return NULL;
+
+    struct tlsf_allocator* tlsf = malloc(sizeof(struct tlsf_allocator));
+    if (!tlsf) return NULL;
+    memset(tlsf, 0, sizeof(*tlsf));
+
+    tlsf->memory = aligned_alloc(TLSF_ALIGN, bytes);
+    if (!tlsf->memory) {
+        free(tlsf);
+        return NULL;
+    }
+    tlsf->total_size = bytes;
+
+    struct tlsf_block* first = tlsf->memory;
+    first->prev_phys = NULL;
+    first->size = bytes - 2 * BLOCK_HEADER;
+
+    struct tlsf_block* sentinel = block_next(first);
+    sentinel->size = 0;     // used, so nothing ever coalesces past the end
+
+    block_mark_free(first);
+    insert_free_block(tlsf, first);
+    STATS_SLAB_CREATED(&tlsf->stats);
+    return tlsf;
+}
+
+static void* tlsf_alloc_block(struct tlsf_allocator* tlsf, size_t size) {
+    size_t adjusted = (size + TLSF_ALIGN - 1) & ~(size_t)(TLSF_ALIGN - 1);
+    if (adjusted < BLOCK_MIN) adjusted = BLOCK_MIN;
+    if (size > BLOCK_MAX || adjusted > BLOCK_MAX) {
+        STATS_FAIL(&tlsf->stats);
+        return NULL;
+    }
+
+    int fl, sl;
+    mapping_search(adjusted, &fl, &sl);
+    struct tlsf_block* b = (fl < TLSF_FL_COUNT) ? search_suitable(tlsf, &fl, &sl) : NULL;
+    if (!b) {
+        STATS_FAIL(&tlsf->stats);
+        return NULL;
+    }
+    remove_free_block(tlsf, b, fl, sl);
+
+    // give the tail back if it can hold a block of its own
+    size_t have = block_size(b);
+    if (have >= adjusted + BLOCK_HEADER + BLOCK_MIN) {
+        block_set_size(b, adjusted);
+        struct tlsf_block* rest = block_next(b);
+        rest->size = have - adjusted - BLOCK_HEADER;
+        block_mark_free(rest);
+        insert_free_block(tlsf, rest);
+    }
+
+    block_mark_used(b);
+    STATS_ALLOC(&tlsf->stats, size, block_size(b));
+    return block_to_ptr(b);
+}
+
+void* tlsf_alloc(struct tlsf_allocator* tlsf, size_t size) {
+    if (!tlsf) return NULL;
+    TRACE_BEGIN("tlsf_alloc");
+    void* ptr = tlsf_alloc_block(tlsf, size);
+    TRACE_END("tlsf_alloc");
+    return ptr;
+}
+
+static void tlsf_free_block(struct tlsf_allocator* tlsf, void* ptr) {
+    char* base = tlsf->memory;
+    if ((char*)ptr < base || (char*)ptr >= base + tlsf->total_size) {
+#ifdef ALLOC_DEBUG
+        alloc_debug_fail("tlsf_free", "pointer not from this allocator", ptr);
+#endif
+        return;
+    }
+
+    struct tlsf_block* b = block_from_ptr(ptr);
+    if (block_is_free(b)) {
+#ifdef ALLOC_DEBUG
+        alloc_debug_fail("tlsf_free", "double free", ptr);
+#endif
+        return;
+    }
+    STATS_FREE(&tlsf->stats, block_size(b));
+
+    // merge with whichever physical neighbours are already free
+    if (block_prev_free(b)) {
+        struct tlsf_block* prev = b->prev_phys;
+        remove_block(tlsf, prev);
+        block_set_size(prev, block_size(prev) + BLOCK_HEADER + block_size(b));
+        b = prev;
+    }
+
+    struct tlsf_block* next = block_next(b);
+    if (block_is_free(next)) {
+        remove_block(tlsf, next);
+        block_set_size(b, block_size(b) + BLOCK_HEADER + block_size(next));
+    }
+
+    block_mark_free(b);
+    insert_free_block(tlsf, b);
+}
+
+void tlsf_free(struct tlsf_allocator* tlsf, void* ptr) {
+    if (!tlsf || !ptr) return;
+    TRACE_BEGIN("tlsf_free");
+    tlsf_free_block(tlsf, ptr);
+    TRACE_END("tlsf_free");
+}
+
+size_t tlsf_usable_size(const void* ptr) {
+    if (!ptr) return 0;
+    return block_size(block_from_ptr(ptr));
+}
+
+int tlsf_check(const struct tlsf_allocator* tlsf) {
+    int errors = 0;
+    struct tlsf_block* b = tlsf->memory;
+    int prev_free = 0;
+
+    for (;;) {
+        if (block_prev_free(b) != prev_free) errors++;
+        if (block_size(b) == 0) break;  // sentinel
+        if (block_is_free(b)) {
+            if (prev_free) errors++;    // two free neighbours should have merged
+            int fl, sl;
+            mapping_insert(block_size(b), &fl, &sl);
+            if (!(tlsf->fl_bitmap & (1U << fl)) || !(tlsf->sl_bitmap[fl] & (1U << sl))) errors++;
+            if (block_prev_free(block_next(b)) && block_next(b)->prev_phys != b) errors++;
+        }
+        prev_free = block_is_free(b);
+        b = block_next(b);
+    }
+
+    if ((char*)b + BLOCK_HEADER != (char*)tlsf->memory + tlsf->total_size) errors++;
+    return errors;
+}
+
+void tlsf_destroy(struct tlsf_allocator* tlsf) {
+    if (!tlsf) return;
+    free(tlsf->memory);
+    free(tlsf);
+}
+
+void tlsf_get_stats(const struct tlsf_allocator* tlsf, struct alloc_stats* out) {
+    if (!tlsf || !out) return;
+    *out = tlsf->stats;
+}
@@ -0,0 +1,49 @@
+#ifndef TLSF_ALLOCATOR_H
+#define TLSF_ALLOCATOR_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "allocStats.h"
+
+// Two-Level Segregated Fit allocator over one fixed region.
+// arbitrary sizes, individual free, O(1) alloc and free (two bitmap
+// lookups, no list walks) and neighbours are coalesced on free.
+// payloads are 16-byte aligned
+
+#define TLSF_ALIGN_LOG2 4
+#define TLSF_ALIGN (1 << TLSF_ALIGN_LOG2)
+#define TLSF_SL_LOG2 5                          // 32 second level lists per first level
+#define TLSF_SL_COUNT (1 << TLSF_SL_LOG2)
+#define TLSF_FL_SHIFT (TLSF_SL_LOG2 + TLSF_ALIGN_LOG2)
+#define TLSF_SMALL_BLOCK (1 << TLSF_FL_SHIFT)   // below this first level 0 is linear
+#define TLSF_FL_MAX 32                          // blocks up to 4GB
+#define TLSF_FL_COUNT (TLSF_FL_MAX - TLSF_FL_SHIFT + 1)
+
+// a free block also uses the first 16 payload bytes for its list links
+struct tlsf_block {
+    struct tlsf_block* prev_phys;   // only valid while the previous block is free
+    size_t size;                    // payload bytes, low bits hold the flags below
+    struct tlsf_block* next_free;
+    struct tlsf_block* prev_free;
+};
+
+struct tlsf_allocator {
+    void* memory;
+    size_t total_size;
+    uint32_t fl_bitmap;
+    uint32_t sl_bitmap[TLSF_FL_COUNT];
+    struct tlsf_block* blocks[TLSF_FL_COUNT][TLSF_SL_COUNT];
+    struct alloc_stats stats;
+};
+
+struct tlsf_allocator* tlsf_create(size_t bytes);
+void* tlsf_alloc(struct tlsf_allocator* tlsf, size_t size);
+void tlsf_free(struct tlsf_allocator* tlsf, void* ptr);
+// payload bytes the block behind ptr really has, >= what was asked for
+size_t tlsf_usable_size(const void* ptr);
+// walks every block and checks links/flags/bitmaps, returns 0 if sane
+int tlsf_check(const struct tlsf_allocator* tlsf);
+void tlsf_destroy(struct tlsf_allocator* tlsf);
+void tlsf_get_stats(const struct tlsf_allocator* tlsf, struct alloc_stats* out);
+
+#endif /* TLSF_ALLOCATOR_H */
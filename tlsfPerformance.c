@@ -0,0 +1,225 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <math.h>
+#include "tlsfAllocator.h"
+#include "perfCounters.h"
+#include "allocDebug.h"
+#include "trace.h"
+
+#define BATCH_SIZE 32
+#define INPUT_DIM 784
+#define HIDDEN_DIM 128
+#define OUTPUT_DIM 10
+
+#define NUM_SLOTS 1024
+#define TLSF_POOL_SIZE (64 * 1024 * 1024)
+
+// one step of an allocation trace: size 0 frees whatever lives in slot
+typedef struct {
+    int slot;
+    size_t size;
+} TraceOp;
+
+typedef struct {
+    const char* name;
+    TraceOp* ops;
+    size_t count;
+} Trace;
+
+struct tlsf_allocator* tlsf = NULL;
+void* slots[NUM_SLOTS];
+
+static void trace_push(Trace* t, size_t* cap, int slot, size_t size) {
+    if (t->count == *cap) {
+        *cap = *cap ? *cap * 2 : 4096;
+        t->ops = realloc(t->ops, *cap * sizeof(TraceOp));
+        if (!t->ops) {
+            printf("Failed to grow trace!\n");
+            exit(1);
+        }
+    }
+    t->ops[t->count].slot = slot;
+    t->ops[t->count].size = size;
+    t->count++;
+}
+
+// forward passes with a random batch size each, activations freed as soon as
+// the next layer is done with them, so sizes and lifetimes keep shifting
+Trace make_mlp_trace(int passes) {
+    Trace t = {"mlp variable batch", NULL, 0};
+    size_t cap = 0;
+
+    for (int p = 0; p < passes; p++) {
+        size_t batch = 1 + rand() % BATCH_SIZE;
+        trace_push(&t, &cap, 0, sizeof(float) * batch * INPUT_DIM);
+        trace_push(&t, &cap, 1, sizeof(float) * batch * HIDDEN_DIM);
+        trace_push(&t, &cap, 0, 0);
+        for (int layer = 2; layer <= 4; layer++) {
+            trace_push(&t, &cap, layer, sizeof(float) * batch * HIDDEN_DIM);
+            trace_push(&t, &cap, layer - 1, 0);
+        }
+        trace_push(&t, &cap, 5, sizeof(float) * batch * OUTPUT_DIM);
+        trace_push(&t, &cap, 4, 0);
+        trace_push(&t, &cap, 5, 0);
+    }
+    return t;
+}
+
+// log-uniform sizes from 16B to 64KB with random lifetimes
+Trace make_random_trace(int ops) {
+    Trace t = {"random 16B-64KB", NULL, 0};
+    size_t cap = 0;
+    char live[NUM_SLOTS] = {0};
+
+    for (int i = 0; i < ops; i++) {
+        int slot = rand() % NUM_SLOTS;
+        if (live[slot]) {
+            trace_push(&t, &cap, slot, 0);
+            live[slot] = 0;
+        } else {
+            double e = 4.0 + 12.0 * ((double)rand() / (double)RAND_MAX);
+            trace_push(&t, &cap, slot, (size_t)pow(2.0, e));
+            live[slot] = 1;
+        }
+    }
+    for (int slot = 0; slot < NUM_SLOTS; slot++) {
+        if (live[slot]) trace_push(&t, &cap, slot, 0);
+    }
+    return t;
+}
+
+void* glibc_alloc(size_t size) { return malloc(size); }
+void glibc_free(void* ptr) { free(ptr); }
+void* tlsf_bench_alloc(size_t size) { return tlsf_alloc(tlsf, size); }
+void tlsf_bench_free(void* ptr) { tlsf_free(tlsf, ptr); }
+
+static inline long long now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+// replays the trace and stores per-op latency, returns total seconds
+double replay(const Trace* t, void* (*alloc_fn)(size_t), void (*free_fn)(void*),
+              long long* latency) {
+    memset(slots, 0, sizeof(slots));
+    long long start = now_ns();
+
+    for (size_t i = 0; i < t->count; i++) {
+        const TraceOp* op = &t->ops[i];
+        long long op_start = now_ns();
+        if (op->size) {
+            slots[op->slot] = alloc_fn(op->size);
+            if (!slots[op->slot]) {
+                printf("Allocation of %zu bytes failed!\n", op->size);
+                exit(1);
+            }
+            // touch it like a real tensor would
+            *(volatile char*)slots[op->slot] = 1;
+        } else {
+            free_fn(slots[op->slot]);
+            slots[op->slot] = NULL;
+        }
+        latency[i] = now_ns() - op_start;
+    }
+
+    return (now_ns() - start) / 1e9;
+}
+
+static int cmp_ll(const void* a, const void* b) {
+    long long x = *(const long long*)a, y = *(const long long*)b;
+    return (x > y) - (x < y);
+}
+
+void print_latency(const char* label, long long* latency, size_t n, double total) {
+    qsort(latency, n, sizeof(long long), cmp_ll);
+    printf("%-6s total %f s, avg %.1f ns/op, p50 %lld ns, p99 %lld ns, p99.99 %lld ns, max %lld ns\n",
+           label, total, total * 1e9 / n, latency[n / 2], latency[(size_t)(n * 0.99)],
+           latency[(size_t)(n * 0.9999)], latency[n - 1]);
+}
+
+int main() {
+    srand(time(NULL));
+
+    tlsf = tlsf_create(TLSF_POOL_SIZE);
+    if (!tlsf) {
+        printf("Failed to create TLSF allocator!\n");
+        exit(1);
+    }
+
+    Trace traces[2] = {make_mlp_trace(20000), make_random_trace(400000)};
+
+    printf("Running benchmarks (%s build)...\n", ALLOC_DEBUG_MODE_STR);
+
+    struct perf_counters pc;
+    perf_counters_open(&pc);
+
+    // per op allocator cost, no matmul in the way, so this is where the
+    // debug overhead shows up most clearly
+    const char* sections[4];
+    double averages[4];
+    char names[4][64];
+
+    for (int t = 0; t < 2; t++) {
+        long long* latency = malloc(traces[t].count * sizeof(long long));
+        struct perf_totals glibc_perf = {0}, tlsf_perf = {0};
+        if (!latency) {
+            printf("Failed to allocate latency buffer!\n");
+            exit(1);
+        }
+
+        printf("\n--- %s (%zu ops) ---\n", traces[t].name, traces[t].count);
+
+        perf_counters_start(&pc);
+        double glibc_time = replay(&traces[t], glibc_alloc, glibc_free, latency);
+        perf_counters_stop(&pc);
+        perf_totals_add(&glibc_perf, &pc);
+        print_latency("glibc", latency, traces[t].count, glibc_time);
+
+        perf_counters_start(&pc);
+        double tlsf_time = replay(&traces[t], tlsf_bench_alloc, tlsf_bench_free, latency);
+        perf_counters_stop(&pc);
+        perf_totals_add(&tlsf_perf, &pc);
+        print_latency("tlsf", latency, traces[t].count, tlsf_time);
+
+        printf("Improvement: %.2f%%\n", 100.0 * (glibc_time - tlsf_time) / glibc_time);
+        snprintf(names[2 * t], sizeof(names[0]), "glibc %s", traces[t].name);
+        snprintf(names[2 * t + 1], sizeof(names[0]), "tlsf %s", traces[t].name);
+        sections[2 * t] = names[2 * t];
+        sections[2 * t + 1] = names[2 * t + 1];
+        averages[2 * t] = glibc_time;
+        averages[2 * t + 1] = tlsf_time;
+        perf_totals_print("glibc", &glibc_perf);
+        perf_totals_print("tlsf", &tlsf_perf);
+
+        if (tlsf_check(tlsf) != 0) {
+            printf("TLSF heap check failed!\n");
+            exit(1);
+        }
+
+        free(latency);
+        free(traces[t].ops);
+    }
+
+    perf_counters_close(&pc);
+    perf_mode_compare("tlsfPerformance", ALLOC_DEBUG_BUILD, sections, averages, 4);
+
+    struct alloc_stats stats;
+    tlsf_get_stats(tlsf, &stats);
+    alloc_stats_print("TLSF", &stats);
+
+#ifdef ALLOC_TRACE
+    // only the last TRACE_RING_SIZE ops make it into the chrome trace,
+    // the histograms see all of them
+    trace_print_histograms();
+    if (trace_export_chrome("trace_tlsf.json") == 0) {
+        printf("Wrote trace_tlsf.json, open it in chrome://tracing or ui.perfetto.dev\n");
+    }
+#endif
+
+    tlsf_destroy(tlsf);
+
+    return 0;
+}
@@ -0,0 +1,217 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include "trace.h"
+
+#define TRACE_CALIBRATE_NS 10000000     // 10ms, enough for a stable tick rate
+
+static const char* point_names[TRACE_MAX_POINTS];
+static int num_points;
+static pthread_mutex_t register_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static _Atomic(struct trace_thread*) trace_threads;
+static _Atomic int next_tid = 1;
+static _Thread_local struct trace_thread* tls_trace;
+
+// first tick/ns pair, taken when the first trace point registers
+static uint64_t base_ticks;
+static uint64_t base_ns;
+static double ticks_per_ns;
+
+static uint64_t now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+int trace_register(const char* name) {
+    pthread_mutex_lock(&register_lock);
+    if (num_points == 0) {
+        base_ticks = trace_ticks();
+        base_ns = now_ns();
+    }
+
+    int id = -1;
+    for (int i = 0; i < num_points; i++) {
+        if (strcmp(point_names[i], name) == 0) id = i;
+    }
+    if (id < 0) {
+        // out of slots, everything else shares the last one
+        if (num_points == TRACE_MAX_POINTS - 1) {
+            point_names[num_points++] = "(other)";
+        }
+        if (num_points == TRACE_MAX_POINTS) {
+            id = TRACE_MAX_POINTS - 1;
+        } else {
+            id = num_points;
+            point_names[num_points++] = name;
+        }
+    }
+    pthread_mutex_unlock(&register_lock);
+    return id;
+}
+
+static struct trace_thread* trace_thread_get() {
+    if (tls_trace) return tls_trace;
+
+    struct trace_thread* t = calloc(1, sizeof(struct trace_thread));
+    if (!t) return NULL;
+    t->tid = atomic_fetch_add(&next_tid, 1);
+
+    struct trace_thread* head = atomic_load(&trace_threads);
+    do {
+        t->next = head;
+    } while (!atomic_compare_exchange_weak(&trace_threads, &head, t));
+
+    tls_trace = t;
+    return t;
+}
+
+void trace_begin(int point) {
+    struct trace_thread* t = trace_thread_get();
+    if (!t) return;
+    if (t->depth < TRACE_MAX_DEPTH) {
+        t->open_point[t->depth] = (uint16_t)point;
+        t->open_start[t->depth] = trace_ticks();
+    }
+    t->depth++;
+}
+
+void trace_end(int point) {
+    uint64_t end = trace_ticks();
+    struct trace_thread* t = tls_trace;
+    if (!t || t->depth == 0) return;
+
+    t->depth--;
+    if (t->depth >= TRACE_MAX_DEPTH) return;     // too deep, we never saw the begin
+
+    // trust the begin's point, an end with the wrong name still closes it
+    (void)point;
+    uint16_t id = t->open_point[t->depth];
+    uint64_t start = t->open_start[t->depth];
+
+    struct trace_histogram* h = t->histograms[id];
+    if (!h) {
+        h = t->histograms[id] = calloc(1, sizeof(struct trace_histogram));
+    }
+    if (h) trace_histogram_record(h, end - start);
+
+    uint64_t head = atomic_load_explicit(&t->head, memory_order_relaxed);
+    struct trace_span* span = &t->ring[head % TRACE_RING_SIZE];
+    span->start = start;
+    span->duration = end - start;
+    span->point = id;
+    span->depth = (uint16_t)t->depth;
+    atomic_store_explicit(&t->head, head + 1, memory_order_release);
+}
+
+void trace_histogram_record(struct trace_histogram* h, uint64_t value) {
+    int row, sub;
+    if (value < TRACE_SUB_BUCKETS) {
+        row = 0;
+        sub = (int)value;
+    } else {
+        int shift = 63 - __builtin_clzll(value) - TRACE_SUB_BITS;
+        row = shift + 1;
+        sub = (int)(value >> shift) - TRACE_SUB_BUCKETS;
+    }
+    h->counts[row][sub]++;
+
+    if (h->total == 0 || value < h->min) h->min = value;
+    if (value > h->max) h->max = value;
+    h->total++;
+}
+
+uint64_t trace_histogram_quantile(const struct trace_histogram* h, double q) {
+    if (h->total == 0) return 0;
+    uint64_t target = (uint64_t)(q * h->total);
+    if (target < 1) target = 1;
+
+    uint64_t seen = 0;
+    for (int row = 0; row < TRACE_MAGNITUDES; row++) {
+        for (int sub = 0; sub < TRACE_SUB_BUCKETS; sub++) {
+            seen += h->counts[row][sub];
+            if (seen < target) continue;
+            if (row == 0) return sub;
+            int shift = row - 1;
+            uint64_t low = (uint64_t)(sub + TRACE_SUB_BUCKETS) << shift;
+            uint64_t mid = low + (((uint64_t)1 << shift) >> 1);
+            return mid > h->max ? h->max : mid;
+        }
+    }
+    return h->max;
+}
+
+// ticks -> ns, measured against the clock since the first trace point
+static double trace_ticks_per_ns() {
+    if (ticks_per_ns > 0.0) return ticks_per_ns;
+    // a run that short would give a noisy rate, wait it out
+    while (now_ns() - base_ns < TRACE_CALIBRATE_NS) {
+    }
+    ticks_per_ns = (double)(trace_ticks() - base_ticks) / (double)(now_ns() - base_ns);
+    return ticks_per_ns;
+}
+
+int trace_export_chrome(const char* path) {
+    FILE* f = fopen(path, "w");
+    if (!f) return -1;
+
+    double tpn = trace_ticks_per_ns();
+    int first = 1;
+    fprintf(f, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+
+    for (struct trace_thread* t = atomic_load(&trace_threads); t; t = t->next) {
+        uint64_t head = atomic_load_explicit(&t->head, memory_order_acquire);
+        uint64_t begin = head > TRACE_RING_SIZE ? head - TRACE_RING_SIZE : 0;
+
+        for (uint64_t i = begin; i < head; i++) {
+            const struct trace_span* span = &t->ring[i % TRACE_RING_SIZE];
+            // complete events, timestamps in microseconds since the first trace point
+            fprintf(f, "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+                    first ? "" : ",\n", point_names[span->point], t->tid,
+                    (double)(span->start - base_ticks) / tpn / 1000.0,
+                    (double)span->duration / tpn / 1000.0);
+            first = 0;
+        }
+    }
+
+    fprintf(f, "\n]}\n");
+    return fclose(f) == 0 ? 0 : -1;
+}
+
+void trace_print_histograms() {
+    struct trace_histogram* merged = malloc(sizeof(struct trace_histogram));
+    if (!merged) return;
+    double tpn = trace_ticks_per_ns();
+
+    printf("Trace latency (ns):\n");
+    printf("  %-20s %10s %10s %10s %10s %10s %10s %10s\n",
+           "point", "count", "min", "p50", "p90", "p99", "p99.9", "max");
+
+    for (int p = 0; p < num_points; p++) {
+        memset(merged, 0, sizeof(*merged));
+        for (struct trace_thread* t = atomic_load(&trace_threads); t; t = t->next) {
+            const struct trace_histogram* h = t->histograms[p];
+            if (!h || h->total == 0) continue;
+            for (int row = 0; row < TRACE_MAGNITUDES; row++) {
+                for (int sub = 0; sub < TRACE_SUB_BUCKETS; sub++) {
+                    merged->counts[row][sub] += h->counts[row][sub];
+                }
+            }
+            if (merged->total == 0 || h->min < merged->min) merged->min = h->min;
+            if (h->max > merged->max) merged->max = h->max;
+            merged->total += h->total;
+        }
+        if (merged->total == 0) continue;
+
+        printf("  %-20s %10llu %10.0f %10.0f %10.0f %10.0f %10.0f %10.0f\n", point_names[p],
+               (unsigned long long)merged->total, merged->min / tpn,
+               trace_histogram_quantile(merged, 0.50) / tpn,
+               trace_histogram_quantile(merged, 0.90) / tpn,
+               trace_histogram_quantile(merged, 0.99) / tpn,
+               trace_histogram_quantile(merged, 0.999) / tpn, merged->max / tpn);
+    }
+    free(merged);
+}
@@ -0,0 +1,92 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+#include <stdatomic.h>
+#include <time.h>
+
+// build with -DALLOC_TRACE to turn the trace points on, otherwise every
+// TRACE_* macro below compiles to nothing and trace.c isn't needed
+
+#define TRACE_RING_SIZE (1 << 16)   // spans kept per thread, oldest get overwritten
+#define TRACE_MAX_DEPTH 32          // nested begins per thread
+#define TRACE_MAX_POINTS 64         // distinct trace point names
+
+// HDR style log-linear buckets: one row per power of two, each split into
+// 2^TRACE_SUB_BITS linear steps, so any value is within ~3% of its bucket
+#define TRACE_SUB_BITS 5
+#define TRACE_SUB_BUCKETS (1 << TRACE_SUB_BITS)
+#define TRACE_MAGNITUDES 64
+
+// one finished begin/end pair
+struct trace_span {
+    uint64_t start;     // ticks
+    uint64_t duration;
+    uint16_t point;
+    uint16_t depth;
+};
+
+struct trace_histogram {
+    uint64_t counts[TRACE_MAGNITUDES][TRACE_SUB_BUCKETS];
+    uint64_t total;
+    uint64_t min;
+    uint64_t max;
+};
+
+// everything one thread records. only its owner ever writes to it, so the
+// hot path is plain stores plus one release store to publish the span
+struct trace_thread {
+    struct trace_thread* next;  // registry list, pushed with a CAS
+    int tid;
+    _Atomic uint64_t head;      // spans ever written, ring slot is head % RING_SIZE
+    struct trace_span ring[TRACE_RING_SIZE];
+
+    int depth;
+    uint64_t open_start[TRACE_MAX_DEPTH];
+    uint16_t open_point[TRACE_MAX_DEPTH];
+
+    struct trace_histogram* histograms[TRACE_MAX_POINTS];  // made on first use
+};
+
+// ticks since whenever, rdtsc where we have it
+static inline uint64_t trace_ticks() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __builtin_ia32_rdtsc();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+#endif
+}
+
+// name -> small id, same name gives the same id. takes a lock, but every
+// trace point only calls it once and caches the answer
+int trace_register(const char* name);
+void trace_begin(int point);
+void trace_end(int point);
+
+// call once the traced threads are done (or at least quiet)
+int trace_export_chrome(const char* path);
+void trace_print_histograms();
+void trace_histogram_record(struct trace_histogram* h, uint64_t value);
+// value at quantile q in [0, 1], bucket midpoint
+uint64_t trace_histogram_quantile(const struct trace_histogram* h, double q);
+
+#ifdef ALLOC_TRACE
+#define TRACE_POINT_ID(name) ({                                             \
+    static _Atomic int trace_point_id_ = -1;                                \
+    int id_ = atomic_load_explicit(&trace_point_id_, memory_order_relaxed); \
+    if (id_ < 0) {                                                          \
+        id_ = trace_register(name);                                         \
+        atomic_store_explicit(&trace_point_id_, id_, memory_order_relaxed); \
+    }                                                                       \
+    id_;                                                                    \
+})
+#define TRACE_BEGIN(name) trace_begin(TRACE_POINT_ID(name))
+#define TRACE_END(name) trace_end(TRACE_POINT_ID(name))
+#else
+#define TRACE_BEGIN(name) ((void)0)
+#define TRACE_END(name) ((void)0)
+#endif
+
+#endif /* TRACE_H */
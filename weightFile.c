@@ -0,0 +1,205 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "weightFile.h"
+
+static uint64_t align_up(uint64_t x) {
+    return (x + WEIGHT_FILE_ALIGN - 1) & ~(uint64_t)(WEIGHT_FILE_ALIGN - 1);
+}
+
+static int write_padding(FILE* f, uint64_t from, uint64_t to) {
+    static const char zeros[WEIGHT_FILE_ALIGN];
+    return to - from == 0 || fwrite(zeros, 1, to - from, f) == to - from ? 0 : -1;
+}
+
+int weight_file_save(const char* path, const struct weight_tensor* tensors, int count) {
+    if (count <= 0) return -1;
+
+    struct weight_entry* entries = calloc(count, sizeof(struct weight_entry));
+    if (!entries) return -1;
+
+    uint64_t offset = align_up(sizeof(struct weight_file_header) + count * sizeof(struct weight_entry));
+    for (int i = 0; i < count; i++) {
+        if (strlen(tensors[i].name) >= WEIGHT_NAME_LEN) {
+            free(entries);
+            return -1;
+        }
+        strcpy(entries[i].name, tensors[i].name);
+        entries[i].rows = tensors[i].rows;
+        entries[i].cols = tensors[i].cols;
+        entries[i].offset = offset;
+        entries[i].bytes = sizeof(float) * (uint64_t)tensors[i].rows * tensors[i].cols;
+        offset = align_up(offset + entries[i].bytes);
+    }
+
+    struct weight_file_header header = {WEIGHT_FILE_MAGIC, WEIGHT_FILE_VERSION, count, 0, offset};
+
+    // write next to it and rename, so a process that already has the old
+    // file mapped never sees it half written
+    char tmp_path[4096];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+    FILE* f = fopen(tmp_path, "wb");
+    if (!f) {
+        free(entries);
+        return -1;
+    }
+
+    int err = 0;
+    uint64_t pos = sizeof(header) + count * sizeof(struct weight_entry);
+    if (fwrite(&header, sizeof(header), 1, f) != 1) err = -1;
+    if (!err && fwrite(entries, sizeof(struct weight_entry), count, f) != (size_t)count) err = -1;
+    for (int i = 0; i < count && !err; i++) {
+        err = write_padding(f, pos, entries[i].offset);
+        if (!err && fwrite(tensors[i].data, 1, entries[i].bytes, f) != entries[i].bytes) err = -1;
+        pos = entries[i].offset + entries[i].bytes;
+    }
+    if (!err) err = write_padding(f, pos, offset);
+
+    if (fclose(f) != 0) err = -1;
+    if (!err && rename(tmp_path, path) != 0) err = -1;
+    if (err) remove(tmp_path);
+
+    free(entries);
+    return err;
+}
+
+struct weight_file* weight_file_open(const char* path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return NULL;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(struct weight_file_header)) {
+        close(fd);
+        errno = EINVAL;
+        return NULL;
+    }
+
+    // private + read only, the kernel hands us page cache pages directly
+    void* base = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);  // the mapping keeps its own reference
+    if (base == MAP_FAILED) return NULL;
+
+    const struct weight_file_header* header = base;
+    const struct weight_entry* entries = (const struct weight_entry*)(header + 1);
+    size_t table_end = sizeof(*header) + (size_t)header->num_tensors * sizeof(struct weight_entry);
+
+    int ok = header->magic == WEIGHT_FILE_MAGIC && header->version == WEIGHT_FILE_VERSION &&
+             header->file_size == (uint64_t)st.st_size && table_end <= (size_t)st.st_size;
+    for (uint32_t i = 0; ok && i < header->num_tensors; i++) {
+        const struct weight_entry* e = &entries[i];
+        ok = e->name[WEIGHT_NAME_LEN - 1] == '\0' && e->rows > 0 && e->cols > 0 &&
+             e->bytes == sizeof(float) * (uint64_t)e->rows * e->cols &&
+             e->offset % WEIGHT_FILE_ALIGN == 0 && e->offset >= table_end &&
+             e->offset <= header->file_size && e->bytes <= header->file_size - e->offset;
+    }
+
+    struct weight_file* wf = ok ? malloc(sizeof(struct weight_file)) : NULL;
+    if (!wf) {
+        munmap(base, st.st_size);
+        errno = ok ? ENOMEM : EINVAL;
+        return NULL;
+    }
+
+    wf->base = base;
+    wf->size = st.st_size;
+    wf->num_tensors = header->num_tensors;
+    wf->entries = entries;
+    return wf;
+}
+
+const float* weight_file_get(const struct weight_file* wf, const char* name, int* rows, int* cols) {
+    if (!wf) return NULL;
+    for (uint32_t i = 0; i < wf->num_tensors; i++) {
+        const struct weight_entry* e = &wf->entries[i];
+        if (strcmp(e->name, name) != 0) continue;
+        if (rows) *rows = e->rows;
+        if (cols) *cols = e->cols;
+        return (const float*)((const char*)wf->base + e->offset);
+    }
+    return NULL;
+}
+
+void weight_file_close(struct weight_file* wf) {
+    if (!wf) return;
+    munmap(wf->base, wf->size);
+    free(wf);
+}
+
+static int resolve_specs(const char* path, const struct weight_file* wf,
+                         const struct weight_spec* specs, int count) {
+    int ok = 1;
+    for (int i = 0; i < count; i++) {
+        int rows, cols;
+        const float* data = weight_file_get(wf, specs[i].name, &rows, &cols);
+        if (!data) {
+            fprintf(stderr, "%s: no tensor %s\n", path, specs[i].name);
+        } else if (rows != specs[i].rows || cols != specs[i].cols) {
+            fprintf(stderr, "%s: tensor %s is %dx%d, expected %dx%d\n", path, specs[i].name,
+                    rows, cols, specs[i].rows, specs[i].cols);
+            data = NULL;
+        }
+        *specs[i].out = data;
+        ok = ok && data;
+    }
+    return ok;
+}
+
+int weight_file_create_random(const char* path, const struct weight_spec* specs, int count) {
+    struct weight_tensor* tensors = calloc(count, sizeof(struct weight_tensor));
+    if (!tensors) return -1;
+
+    int err = 0;
+    for (int i = 0; i < count && !err; i++) {
+        size_t n = (size_t)specs[i].rows * specs[i].cols;
+        float* data = malloc(sizeof(float) * n);
+        if (!data) {
+            err = -1;
+            break;
+        }
+        for (size_t j = 0; j < n; j++) {
+            data[j] = -0.5f + ((float)rand() / (float)RAND_MAX);
+        }
+        tensors[i].name = specs[i].name;
+        tensors[i].data = data;
+        tensors[i].rows = specs[i].rows;
+        tensors[i].cols = specs[i].cols;
+    }
+    if (!err) err = weight_file_save(path, tensors, count);
+
+    for (int i = 0; i < count; i++) free((void*)tensors[i].data);
+    free(tensors);
+    return err;
+}
+
+struct weight_file* weight_file_load_or_create(const char* path, const struct weight_spec* specs,
+                                               int count) {
+    for (int i = 0; i < count; i++) *specs[i].out = NULL;
+
+    struct weight_file* wf = weight_file_open(path);
+    // a missing file is the only thing we fix ourselves, anything else
+    // might be a real model and isn't ours to overwrite
+    if (!wf && errno == ENOENT) {
+        if (weight_file_create_random(path, specs, count) != 0) {
+            fprintf(stderr, "%s: couldn't write random weights\n", path);
+            return NULL;
+        }
+        printf("No weights at %s, wrote a random model there\n", path);
+        wf = weight_file_open(path);
+    }
+    if (!wf) {
+        fprintf(stderr, "%s: %s\n", path, errno == EINVAL ? "not a valid weight file" : strerror(errno));
+        return NULL;
+    }
+
+    if (!resolve_specs(path, wf, specs, count)) {
+        for (int i = 0; i < count; i++) *specs[i].out = NULL;
+        weight_file_close(wf);
+        return NULL;
+    }
+    return wf;
+}
@@ -0,0 +1,81 @@
+#ifndef WEIGHT_FILE_H
+#define WEIGHT_FILE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define WEIGHT_FILE_MAGIC 0x57504c4d    // "MLPW" little endian
+#define WEIGHT_FILE_VERSION 1
+#define WEIGHT_FILE_ALIGN 64            // every tensor starts on a cache line
+#define WEIGHT_NAME_LEN 32
+
+// on disk: header, then num_tensors entries, then the float data.
+// offsets are from the start of the file so a loaded tensor is just
+// base + offset, nothing gets copied or fixed up
+struct weight_file_header {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t num_tensors;
+    uint32_t reserved;
+    uint64_t file_size;
+};
+
+struct weight_entry {
+    char name[WEIGHT_NAME_LEN];
+    int32_t rows;
+    int32_t cols;
+    uint64_t offset;
+    uint64_t bytes;
+};
+
+// what the writer takes, row major floats
+struct weight_tensor {
+    const char* name;
+    const float* data;
+    int rows;
+    int cols;
+};
+
+struct weight_file {
+    void* base;     // read only mapping of the whole file
+    size_t size;
+    uint32_t num_tensors;
+    const struct weight_entry* entries;
+};
+
+// 0 on success, -1 if anything couldn't be written
+int weight_file_save(const char* path, const struct weight_tensor* tensors, int count);
+
+// maps the file read only and checks the table, NULL if it's missing or bad.
+// errno tells which: whatever open() said, or EINVAL for a file that isn't
+// a valid weight file. the pages are shared with every other process
+// mapping the same file
+struct weight_file* weight_file_open(const char* path);
+
+// points straight into the mapping, writing through it will segfault.
+// NULL if there's no tensor by that name. rows/cols may be NULL
+const float* weight_file_get(const struct weight_file* wf, const char* name, int* rows, int* cols);
+
+void weight_file_close(struct weight_file* wf);
+
+// one tensor a model expects, *out is pointed into the mapping by
+// weight_file_load_or_create
+struct weight_spec {
+    const char* name;
+    int rows;
+    int cols;
+    const float** out;
+};
+
+// writes a random model with exactly these tensors (uniform in [-0.5, 0.5)
+// from rand()) to path, replacing whatever is there. 0 on success
+int weight_file_create_random(const char* path, const struct weight_spec* specs, int count);
+
+// maps path and resolves every spec. only when the file doesn't exist at
+// all does it write a random model there first. a file that is bad or
+// doesn't match the specs is left alone: what's wrong goes to stderr and
+// the result is NULL, the outs are then NULL as well
+struct weight_file* weight_file_load_or_create(const char* path, const struct weight_spec* specs,
+                                               int count);
+
+#endif /* WEIGHT_FILE_H */